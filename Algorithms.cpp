@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <iostream>
 #include <climits>
+#include <limits>
 #include <deque>
 #include <queue>
 
@@ -17,16 +18,21 @@ namespace ariel
 {
     void Algorithms::DFS(const Graph &g, size_t v, std::vector<bool> &visited)
     {
-        // Mark the current vertex as visited
-        visited[static_cast<std::vector<bool>::size_type>(v)] = true;
-        const std::vector<std::vector<int>> &matrix = g.getAdjacencyMatrix();
-
-        // Recursively visit all adjacent vertices that have not been visited yet
-        for (size_t i = 0; i < g.getnumVertices(); i++)
+        // Explicit stack instead of recursion, so a long path cannot overflow the call stack
+        std::vector<size_t> stack(1, v);
+        visited[v] = true;
+        while (!stack.empty())
         {
-            if (matrix[v][i] != 0 && !visited[i])
+            size_t u = stack.back();
+            stack.pop_back();
+            // Mark the adjacent vertices when they are pushed so each one enters the stack once
+            for (const Graph::Edge &edge : g.neighbors(u))
             {
-                DFS(g, i, visited);
+                if (!visited[edge.vertex])
+                {
+                    visited[edge.vertex] = true;
+                    stack.push_back(edge.vertex);
+                }
             }
         }
     }
@@ -39,6 +45,16 @@ namespace ariel
             return true;
         }
         size_t vertices = g.getnumVertices();
+        // Without edges only a single vertex is connected (cached edge count, no scan)
+        if (g.getNumEdges() == 0)
+        {
+            return vertices == 1;
+        }
+        // These checks only look at the edge pattern, so a dense matrix is traversed as a bitset
+        if (g.getStorage() != Graph::Storage::Sparse)
+        {
+            return isConnected(BitGraph(g));
+        }
         std::vector<bool> visited(vertices, false);
 
         // Perform DFS traversal starting from vertex 0
@@ -53,19 +69,29 @@ namespace ariel
             }
         }
 
-        // If the graph is directed, perform DFS from each vertex and check if all vertices are reachable
+        // A directed graph is connected when vertex 0 reaches every vertex and every vertex reaches vertex 0,
+        // which is the same traversal over the transposed graph
         if (g.getIsDirected())
         {
-            for (size_t i = 1; i < vertices; i++)
+            std::vector<Graph::WeightedEdge> reversed;
+            reversed.reserve(g.getNumEdges());
+            for (size_t u = 0; u < vertices; u++)
             {
-                visited = std::vector<bool>(vertices, false);
-                DFS(g, i, visited);
-                for (size_t j = 0; j < vertices; j++)
+                for (const Graph::Edge &edge : g.neighbors(u))
                 {
-                    if (!visited[j])
-                    {
-                        return false;
-                    }
+                    reversed.push_back(Graph::WeightedEdge{edge.vertex, u, edge.weight});
+                }
+            }
+            Graph transposed;
+            transposed.loadEdges(vertices, std::move(reversed));
+
+            visited.assign(vertices, false);
+            DFS(transposed, 0, visited);
+            for (size_t i = 0; i < vertices; i++)
+            {
+                if (!visited[i])
+                {
+                    return false;
                 }
             }
         }
@@ -90,23 +116,24 @@ namespace ariel
         {
             for (size_t u = 0; u < V; u++)
             {
-                for (size_t v = 0; v < V; v++)
+                for (const Graph::Edge &edge : g.neighbors(u))
                 {
-                    if (g.getAdjacencyMatrix()[u][v] != 0 && distances[u] != INT_MAX && distances[u] + (size_t)g.getAdjacencyMatrix()[u][v] < distances[v])
+                    size_t v = edge.vertex;
+                    if (distances[u] != INT_MAX && distances[u] + (size_t)edge.weight < distances[v])
                     {
-                        distances[v] = distances[u] + (size_t)g.getAdjacencyMatrix()[u][v];
+                        distances[v] = distances[u] + (size_t)edge.weight;
                         parent[v] = u;
                     }
                 }
             }
         }
 
-        // Check for negative-weight cycles
-        for (size_t u = 0; u < V; u++)
+        // Check for negative-weight cycles; impossible when every weight is positive
+        for (size_t u = 0; u < V && g.hasNegativeWeights(); u++)
         {
-            for (size_t v = 0; v < V; v++)
+            for (const Graph::Edge &edge : g.neighbors(u))
             {
-                if (g.getAdjacencyMatrix()[u][v] != 0 && distances[u] != INT_MAX && distances[u] + (size_t)g.getAdjacencyMatrix()[u][v] < distances[v])
+                if (distances[u] != INT_MAX && distances[u] + (size_t)edge.weight < distances[edge.vertex])
                 {
                     return "-1"; // Negative cycle found
                 }
@@ -131,59 +158,49 @@ namespace ariel
 
     bool Algorithms::DFSCycle(const Graph &g, size_t v, vector<bool> &visited, vector<size_t> &parent, deque<int> &cycle)
     {
+        // Explicit DFS stack: the vertex and the neighbors of its row not scanned yet
+        struct Frame
+        {
+            size_t vertex;
+            Graph::NeighborIterator next;
+            Graph::NeighborIterator end;
+        };
+        std::vector<Frame> stack;
+
         // Mark the current vertex as visited and add it to the cycle
         visited[v] = true;
-        cycle.push_back(v);
-
-        // Get the adjacency matrix of the graph
-        const vector<vector<int>> &matrix = g.getAdjacencyMatrix();
+        cycle.push_back(static_cast<int>(v));
+        stack.push_back(Frame{v, g.neighbors(v).begin(), g.neighbors(v).end()});
 
-        // Iterate over all vertices adjacent to the current vertex
-        for (size_t u = 0; u < g.getnumVertices(); u++)
+        while (!stack.empty())
         {
-            // If there is an edge between v and u
-            if (matrix[v][u] != 0)
+            Frame &top = stack.back();
+            // No neighbor left, backtrack
+            if (top.next == top.end)
             {
-                // If u has not been visited yet, recursively explore it
-                if (!visited[u])
-                {
-                    parent[u] = v;
-                    if (DFSCycle(g, u, visited, parent, cycle))
-                    {
-                        return true;
-                    }
-                }
-                // If u has been visited and is not the parent of v, a cycle is found
-                else if (parent[v] != u)
-                {
-                    // Construct the cycle path
-                    vector<int> cyclePath;
-                    cyclePath.push_back(u);
-                    for (size_t pv = v; pv != u; pv = parent[pv])
-                    {
-                        cyclePath.push_back(pv);
-                    }
-                    cyclePath.push_back(u);
-
-                    // Print the cycle path
-                    cout << "The cycle is: ";
-                    for (auto it = cyclePath.rbegin(); it != cyclePath.rend(); ++it)
-                    {
-                        cout << *it;
-                        if (it != cyclePath.rend() - 1)
-                        {
-                            cout << "->";
-                        }
-                    }
-                    cout << endl;
+                cycle.pop_back();
+                stack.pop_back();
+                continue;
+            }
+            size_t w = top.vertex;
+            size_t u = (*top.next).vertex;
+            ++top.next;
 
-                    return true;
-                }
+            // If u has not been visited yet, explore it next
+            if (!visited[u])
+            {
+                visited[u] = true;
+                parent[u] = w;
+                cycle.push_back(static_cast<int>(u));
+                stack.push_back(Frame{u, g.neighbors(u).begin(), g.neighbors(u).end()});
+            }
+            // If u has been visited and is not the parent of w, a cycle is found
+            else if (parent[w] != u)
+            {
+                printCycle(parent, w, u);
+                return true;
             }
         }
-
-        // If no cycle is found, backtrack
-        cycle.pop_back();
         return false;
     }
 
@@ -195,6 +212,11 @@ namespace ariel
             return false;
         }
 
+        if (g.getStorage() != Graph::Storage::Sparse)
+        {
+            return isContainsCycle(BitGraph(g));
+        }
+
         // Initialize vectors to track visited vertices and their parents
         size_t V = g.getnumVertices();
         vector<bool> visited(V, false);
@@ -227,23 +249,24 @@ namespace ariel
             q.pop();
 
             // Self loop, graph is not bipartite
-            if (g.getAdjacencyMatrix()[u][u] != 0)
+            if (g.getEdgeWeight(u, u) != 0)
             {
                 return false;
             }
 
             // Traverse all adjacent vertices of u
-            for (size_t v = 0; v < g.getnumVertices(); v++)
+            for (const Graph::Edge &edge : g.neighbors(u))
             {
+                size_t v = edge.vertex;
                 // An edge from u to v exists and destination v is not colored
-                if (g.getAdjacencyMatrix()[u][v] && color[v] == -1)
+                if (color[v] == -1)
                 {
                     // Assign alternate color to this adjacent v of u
                     color[v] = 1 - color[u];
                     q.push(v);
                 }
                 // An edge from u to v exists and destination v is colored with the same color as u
-                else if (g.getAdjacencyMatrix()[u][v] && color[v] == color[u])
+                else if (color[v] == color[u])
                 {
                     return false; // Not bipartite
                 }
@@ -255,6 +278,15 @@ namespace ariel
 
     std::string Algorithms::isBipartite(Graph &g)
     {
+        // A self loop joins a vertex to itself, so the graph cannot be bipartite
+        if (g.hasSelfLoops())
+        {
+            return "0";
+        }
+        if (g.getStorage() != Graph::Storage::Sparse)
+        {
+            return isBipartite(BitGraph(g));
+        }
         std::vector<int> color(g.getnumVertices(), -1); // Initialize all vertices as not colored (-1)
 
         // Check if the graph is bipartite using BFS traversal
@@ -269,6 +301,11 @@ namespace ariel
             }
         }
 
+        return bipartiteSets(color);
+    }
+
+    std::string Algorithms::bipartiteSets(const std::vector<int> &color)
+    {
         // Construct partitions A and B based on vertex colors
         std::vector<size_t> setA, setB;
         for (size_t i = 0; i < color.size(); i++)
@@ -319,11 +356,12 @@ namespace ariel
         {
             for (size_t u = 0; u < numVertices; u++)
             {
-                for (size_t v = 0; v < numVertices; v++)
+                for (const Graph::Edge &edge : g.neighbors(u))
                 {
-                    if (g.getAdjacencyMatrix()[u][v] != 0 && distance[u] != std::numeric_limits<int>::max() && distance[u] + g.getAdjacencyMatrix()[u][v] < distance[v])
+                    size_t v = edge.vertex;
+                    if (distance[u] != std::numeric_limits<int>::max() && distance[u] + edge.weight < distance[v])
                     {
-                        distance[v] = distance[u] + g.getAdjacencyMatrix()[u][v];
+                        distance[v] = distance[u] + edge.weight;
                         predecessor[v] = u;
                     }
                 }
@@ -333,9 +371,9 @@ namespace ariel
         // Check for negative-weight cycles
         for (size_t u = 0; u < numVertices; u++)
         {
-            for (size_t v = 0; v < numVertices; v++)
+            for (const Graph::Edge &edge : g.neighbors(u))
             {
-                if (g.getAdjacencyMatrix()[u][v] != 0 && distance[u] != std::numeric_limits<int>::max() && distance[u] + g.getAdjacencyMatrix()[u][v] < distance[v])
+                if (distance[u] != std::numeric_limits<int>::max() && distance[u] + edge.weight < distance[edge.vertex])
                 {
                     // Negative cycle found, construct cycle
                     std::vector<int> cycle;
@@ -369,7 +407,8 @@ namespace ariel
 
     std::string Algorithms::negativeCycle(Graph &g)
     {
-        if (g.getnumVertices() == 0)
+        // A negative cycle needs at least one negative edge
+        if (g.getnumVertices() == 0 || !g.hasNegativeWeights())
         {
             return "No negative cycle";
         }
@@ -383,4 +422,197 @@ namespace ariel
         }
         return "No negative cycle";
     }
-}
\ No newline at end of file
+
+    void Algorithms::printCycle(const std::vector<size_t> &parent, size_t v, size_t u)
+    {
+        // Construct the cycle path
+        vector<int> cyclePath;
+        cyclePath.push_back(u);
+        for (size_t pv = v; pv != u; pv = parent[pv])
+        {
+            cyclePath.push_back(pv);
+        }
+        cyclePath.push_back(u);
+
+        // Print the cycle path
+        cout << "The cycle is: ";
+        for (auto it = cyclePath.rbegin(); it != cyclePath.rend(); ++it)
+        {
+            cout << *it;
+            if (it != cyclePath.rend() - 1)
+            {
+                cout << "->";
+            }
+        }
+        cout << endl;
+    }
+
+    bool Algorithms::reachesAll(const BitGraph &g)
+    {
+        size_t words = g.getWordsPerRow();
+        std::vector<BitGraph::Word> visited(words, 0);
+        std::vector<BitGraph::Word> frontier(words, 0);
+        std::vector<BitGraph::Word> next(words);
+        visited[0] = frontier[0] = 1;
+        size_t reached = 1;
+
+        // Each step ORs the rows of the whole frontier: frontier = (rows of frontier) & ~visited
+        while (reached < g.getnumVertices())
+        {
+            std::fill(next.begin(), next.end(), 0);
+            for (size_t w = 0; w < words; w++)
+            {
+                for (BitGraph::Word word = frontier[w]; word != 0; word &= word - 1)
+                {
+                    const BitGraph::Word *row = g.row(w * BitGraph::WordBits + static_cast<size_t>(__builtin_ctzll(word)));
+                    for (size_t k = 0; k < words; k++)
+                    {
+                        next[k] |= row[k];
+                    }
+                }
+            }
+            size_t added = 0;
+            for (size_t k = 0; k < words; k++)
+            {
+                next[k] &= ~visited[k];
+                visited[k] |= next[k];
+                added += static_cast<size_t>(__builtin_popcountll(next[k]));
+            }
+            if (added == 0)
+            {
+                return false;
+            }
+            reached += added;
+            frontier.swap(next);
+        }
+        return true;
+    }
+
+    bool Algorithms::isConnected(const BitGraph &g)
+    {
+        if (g.getnumVertices() == 0)
+        {
+            return true;
+        }
+        // A directed graph is connected when vertex 0 reaches every vertex and every vertex reaches vertex 0
+        return reachesAll(g) && (!g.getIsDirected() || reachesAll(g.transposed()));
+    }
+
+    bool Algorithms::isContainsCycle(const BitGraph &g)
+    {
+        size_t V = g.getnumVertices();
+        size_t words = g.getWordsPerRow();
+        std::vector<BitGraph::Word> visited(words, 0);
+        vector<size_t> parent(V, (size_t)-1);
+        // Explicit DFS stack: the vertex and the first column of its row not scanned yet
+        std::vector<std::pair<size_t, size_t>> stack;
+
+        for (size_t root = 0; root < V; root++)
+        {
+            if ((visited[root / BitGraph::WordBits] >> (root % BitGraph::WordBits) & 1U) != 0)
+            {
+                continue;
+            }
+            visited[root / BitGraph::WordBits] |= BitGraph::Word(1) << (root % BitGraph::WordBits);
+            stack.push_back(std::make_pair(root, 0));
+            while (!stack.empty())
+            {
+                size_t v = stack.back().first;
+                size_t column = stack.back().second;
+                const BitGraph::Word *row = g.row(v);
+
+                // Find the next neighbor of v, skipping empty words
+                size_t w = column / BitGraph::WordBits;
+                BitGraph::Word word = (w < words) ? row[w] & (~BitGraph::Word(0) << (column % BitGraph::WordBits)) : 0;
+                while (word == 0 && ++w < words)
+                {
+                    word = row[w];
+                }
+                if (word == 0)
+                {
+                    stack.pop_back();
+                    continue;
+                }
+                size_t u = w * BitGraph::WordBits + static_cast<size_t>(__builtin_ctzll(word));
+                stack.back().second = u + 1;
+
+                // Same rule as DFSCycle: recurse into unvisited vertices, any other visited vertex but the parent closes a cycle
+                if ((visited[w] >> (u % BitGraph::WordBits) & 1U) == 0)
+                {
+                    visited[w] |= BitGraph::Word(1) << (u % BitGraph::WordBits);
+                    parent[u] = v;
+                    stack.push_back(std::make_pair(u, 0));
+                }
+                else if (parent[v] != u)
+                {
+                    printCycle(parent, v, u);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    std::string Algorithms::isBipartite(const BitGraph &g)
+    {
+        size_t V = g.getnumVertices();
+        size_t words = g.getWordsPerRow();
+        // sides[1] holds the vertices colored 1 (set A), sides[0] those colored 0
+        std::vector<BitGraph::Word> sides[2] = {std::vector<BitGraph::Word>(words, 0), std::vector<BitGraph::Word>(words, 0)};
+        std::vector<BitGraph::Word> frontier(words);
+        std::vector<BitGraph::Word> next(words);
+
+        for (size_t root = 0; root < V; root++)
+        {
+            size_t rootWord = root / BitGraph::WordBits;
+            BitGraph::Word rootBit = BitGraph::Word(1) << (root % BitGraph::WordBits);
+            if (((sides[0][rootWord] | sides[1][rootWord]) & rootBit) != 0)
+            {
+                continue;
+            }
+            std::fill(frontier.begin(), frontier.end(), 0);
+            frontier[rootWord] = rootBit;
+            sides[1][rootWord] |= rootBit;
+            int side = 1;
+
+            // Color one BFS level per step; the next level takes the other color
+            bool growing = true;
+            while (growing)
+            {
+                std::fill(next.begin(), next.end(), 0);
+                for (size_t w = 0; w < words; w++)
+                {
+                    for (BitGraph::Word word = frontier[w]; word != 0; word &= word - 1)
+                    {
+                        const BitGraph::Word *row = g.row(w * BitGraph::WordBits + static_cast<size_t>(__builtin_ctzll(word)));
+                        for (size_t k = 0; k < words; k++)
+                        {
+                            next[k] |= row[k];
+                        }
+                    }
+                }
+                growing = false;
+                for (size_t k = 0; k < words; k++)
+                {
+                    // An edge into a vertex of the frontier's own color breaks the 2-coloring
+                    if ((next[k] & sides[side][k]) != 0)
+                    {
+                        return "0"; // Not bipartite
+                    }
+                    next[k] &= ~sides[1 - side][k];
+                    sides[1 - side][k] |= next[k];
+                    growing = growing || next[k] != 0;
+                }
+                frontier.swap(next);
+                side = 1 - side;
+            }
+        }
+
+        std::vector<int> color(V);
+        for (size_t i = 0; i < V; i++)
+        {
+            color[i] = static_cast<int>(sides[1][i / BitGraph::WordBits] >> (i % BitGraph::WordBits) & 1U);
+        }
+        return bipartiteSets(color);
+    }
+}
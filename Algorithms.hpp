@@ -7,6 +7,7 @@
 #define ALGORITHMS_H
 
 #include "Graph.hpp"
+#include "BitGraph.hpp"
 #include <vector>
 #include <string>
 #include <stack>
@@ -17,7 +18,7 @@ namespace ariel
     {
     private:
         /**
-         * @brief Performs a depth-first search (DFS) traversal starting from a given vertex.
+         * @brief Marks every vertex reachable from a given vertex, using an explicit stack instead of recursion.
          *
          * @param g The graph to traverse.
          * @param v The starting vertex for the DFS traversal.
@@ -26,10 +27,10 @@ namespace ariel
         static void DFS(const Graph &g, size_t v, std::vector<bool> &visited);
 
         /**
-         * @brief Performs a depth-first search (DFS) traversal to detect cycles in a graph.
+         * @brief Performs an iterative depth-first search (DFS) traversal to detect cycles in a graph.
          *
          * @param g The graph to traverse.
-         * @param v The current vertex in the DFS traversal.
+         * @param v The root vertex of the DFS traversal.
          * @param visited A vector to track visited vertices.
          * @param parent A vector to track parent vertices in the traversal.
          * @param cycle A deque to store the cycle if found.
@@ -56,6 +57,31 @@ namespace ariel
          */
         static std::string negativeCycleUtil(const Graph &g, size_t source);
 
+        /**
+         * @brief Checks if every vertex is reachable from vertex 0, expanding a whole BFS level per step.
+         *
+         * @param g The bit-packed graph to traverse.
+         * @return true if all vertices are reachable from vertex 0, false otherwise.
+         */
+        static bool reachesAll(const BitGraph &g);
+
+        /**
+         * @brief Prints the cycle closed by the edge from v back to its ancestor u.
+         *
+         * @param parent The DFS parent of every visited vertex.
+         * @param v The vertex whose edge closes the cycle.
+         * @param u The ancestor the edge leads to.
+         */
+        static void printCycle(const std::vector<size_t> &parent, size_t v, size_t u);
+
+        /**
+         * @brief Builds the answer of isBipartite from a valid 2-coloring.
+         *
+         * @param color The color of every vertex; vertices with color 1 form set A.
+         * @return A string listing the partitions A and B.
+         */
+        static std::string bipartiteSets(const std::vector<int> &color);
+
     public:
         /**
          * @brief Checks if a graph is connected.
@@ -65,6 +91,14 @@ namespace ariel
          */
         static bool isConnected(Graph &g);
 
+        /**
+         * @brief Checks if a bit-packed graph is connected, using word-level frontier expansion.
+         *
+         * @param g The graph to check for connectivity.
+         * @return true if the graph is connected, false otherwise.
+         */
+        static bool isConnected(const BitGraph &g);
+
         /**
          * @brief Finds the shortest path between two vertices in a graph.
          *
@@ -83,6 +117,14 @@ namespace ariel
          */
         static bool isContainsCycle(Graph &g);
 
+        /**
+         * @brief Checks if a bit-packed graph contains a cycle, skipping empty words of each row.
+         *
+         * @param g The graph to check for cycles.
+         * @return true if the graph contains a cycle, false otherwise.
+         */
+        static bool isContainsCycle(const BitGraph &g);
+
         /**
          * @brief Checks if a graph is bipartite.
          *
@@ -91,6 +133,14 @@ namespace ariel
          */
         static std::string isBipartite(Graph &g);
 
+        /**
+         * @brief Checks if a bit-packed graph is bipartite, coloring a whole BFS level per step.
+         *
+         * @param g The graph to check for bipartiteness.
+         * @return A string indicating if the graph is bipartite and the partitions if it is.
+         */
+        static std::string isBipartite(const BitGraph &g);
+
         /**
          * @brief Finds the negative cycle in a graph.
          *
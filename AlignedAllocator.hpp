@@ -0,0 +1,78 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+
+namespace ariel
+{
+    /**
+     * @brief Minimal C++11 allocator that returns memory aligned to a fixed boundary.
+     *
+     * Used for the Graph cell buffer so that every row starts on a cache line.
+     * The original pointer returned by operator new is stored just before the
+     * aligned block so deallocate can hand it back.
+     *
+     * @tparam T The element type.
+     * @tparam Alignment The alignment in bytes (must be a power of two).
+     */
+    template <typename T, std::size_t Alignment = 64>
+    class AlignedAllocator
+    {
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind
+        {
+            typedef AlignedAllocator<U, Alignment> other;
+        };
+
+        AlignedAllocator() {}
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+        T *allocate(std::size_t count)
+        {
+            if (count > (std::numeric_limits<std::size_t>::max() - Alignment - sizeof(void *)) / sizeof(T))
+            {
+                throw std::bad_alloc();
+            }
+            void *raw = ::operator new(count * sizeof(T) + Alignment + sizeof(void *));
+            std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *);
+            std::uintptr_t aligned = (start + Alignment - 1) & ~static_cast<std::uintptr_t>(Alignment - 1);
+            reinterpret_cast<void **>(aligned)[-1] = raw;
+            return reinterpret_cast<T *>(aligned);
+        }
+
+        void deallocate(T *pointer, std::size_t)
+        {
+            if (pointer != nullptr)
+            {
+                ::operator delete(reinterpret_cast<void **>(pointer)[-1]);
+            }
+        }
+    };
+
+    template <typename T, typename U, std::size_t Alignment>
+    bool operator==(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &)
+    {
+        return true;
+    }
+
+    template <typename T, typename U, std::size_t Alignment>
+    bool operator!=(const AlignedAllocator<T, Alignment> &, const AlignedAllocator<U, Alignment> &)
+    {
+        return false;
+    }
+
+} // namespace ariel
+
+#endif // ALIGNED_ALLOCATOR_HPP
@@ -0,0 +1,76 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+/*
+ * Benchmark of the dense graph product.
+ * Usage: ./bench [vertices] [max threads]
+ * Times the same product with 1, 2, 4, ... threads and prints the speedup over one thread.
+ */
+
+#include "Graph.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Best of a few runs, in seconds
+static double timeProduct(const ariel::Graph &left, const ariel::Graph &right)
+{
+    double best = 0;
+    for (int run = 0; run < 3; run++)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        ariel::Graph product = left * right;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best)
+        {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t vertices = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1024;
+    size_t maxThreads = (argc > 2) ? strtoul(argv[2], nullptr, 10) : thread::hardware_concurrency();
+    if (vertices == 0 || maxThreads == 0)
+    {
+        cerr << "Usage: " << argv[0] << " [vertices] [max threads]" << endl;
+        return 1;
+    }
+
+    // Random directed graph with small weights, so the dense kernel is used
+    vector<vector<int>> matrix(vertices, vector<int>(vertices, 0));
+    unsigned int seed = 1;
+    for (size_t i = 0; i < vertices; i++)
+    {
+        for (size_t j = 0; j < vertices; j++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            matrix[i][j] = (i == j) ? 0 : static_cast<int>((seed >> 16) % 7) - 3;
+        }
+    }
+    ariel::Graph graph;
+    graph.loadGraph(matrix);
+
+    cout << "Product of two " << vertices << "x" << vertices << " graphs" << endl;
+    double serial = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        ariel::Graph::setThreadCount(threads);
+        double seconds = timeProduct(graph, graph);
+        if (threads == 1)
+        {
+            serial = seconds;
+        }
+        cout << setw(4) << threads << " threads: " << fixed << setprecision(3) << seconds << " s, speedup "
+             << setprecision(2) << serial / seconds << "x" << endl;
+    }
+    return 0;
+}
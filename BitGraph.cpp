@@ -0,0 +1,276 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#include "BitGraph.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace ariel
+{
+    const size_t BitGraph::WordBits;
+    const size_t BitGraph::FourRussiansBits;
+
+    BitGraph::BitGraph(const Graph &graph) : BitGraph()
+    {
+        resize(graph.getnumVertices());
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            for (const Graph::Edge &edge : graph.neighbors(i))
+            {
+                set(i, edge.vertex);
+            }
+        }
+        this->symmetry.store(graph.getIsDirected() ? Symmetry::Directed : Symmetry::Symmetric);
+    }
+
+    void BitGraph::loadGraph(const vector<vector<int>> &matrix)
+    {
+        if (matrix.empty())
+        {
+            throw invalid_argument("Invalid graph: The graph is empty.");
+        }
+        for (size_t i = 0; i < matrix.size(); i++)
+        {
+            if (matrix[i].size() != matrix.size())
+            {
+                throw invalid_argument("Invalid graph: The graph is not a square matrix.");
+            }
+        }
+        resize(matrix.size());
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            for (size_t j = 0; j < this->vertices; j++)
+            {
+                if (matrix[i][j] != 0)
+                {
+                    set(i, j);
+                }
+            }
+        }
+        this->symmetry.store(Graph::isSimetric(matrix) ? Symmetry::Symmetric : Symmetry::Directed);
+    }
+
+    size_t BitGraph::getnumVertices() const
+    {
+        return this->vertices;
+    }
+
+    bool BitGraph::getIsDirected() const
+    {
+        Symmetry known = this->symmetry.load();
+        if (known == Symmetry::Unknown)
+        {
+            // Threads that scan at the same time store the same answer
+            known = hasSymmetricBits() ? Symmetry::Symmetric : Symmetry::Directed;
+            this->symmetry.store(known);
+        }
+        return known == Symmetry::Directed;
+    }
+
+    size_t BitGraph::getWordsPerRow() const
+    {
+        return this->wordsPerRow;
+    }
+
+    bool BitGraph::isAdjacent(size_t from, size_t to) const
+    {
+        if (from >= this->vertices || to >= this->vertices)
+        {
+            throw invalid_argument("Invalid vertex: The vertex is out of range.");
+        }
+        return (row(from)[to / WordBits] >> (to % WordBits) & 1U) != 0;
+    }
+
+    const BitGraph::Word *BitGraph::row(size_t vertex) const
+    {
+        return this->bits.data() + vertex * this->stride;
+    }
+
+    BitGraph BitGraph::transposed() const
+    {
+        BitGraph transpose;
+        transpose.resize(this->vertices);
+        transpose.symmetry = this->symmetry;
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            const Word *cells = row(i);
+            for (size_t w = 0; w < this->wordsPerRow; w++)
+            {
+                // Visit only the set bits of the word
+                for (Word word = cells[w]; word != 0; word &= word - 1)
+                {
+                    transpose.set(w * WordBits + static_cast<size_t>(__builtin_ctzll(word)), i);
+                }
+            }
+        }
+        return transpose;
+    }
+
+    BitGraph BitGraph::operator*(const BitGraph &other) const
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to multiply.");
+        }
+        BitGraph product;
+        product.resize(this->vertices);
+        // A table of 2^8 rows pays for itself once a group of 8 columns holds more than about 1 + 256 / V bits per row
+        if (countBits() * FourRussiansBits > this->vertices * (this->vertices + (1U << FourRussiansBits)))
+        {
+            multiplyFourRussians(other, product);
+        }
+        else
+        {
+            multiplyRows(other, product);
+        }
+        // (AA)^T = A^T A^T = AA for a symmetric A; anything else would need a transpose of the result
+        if (this == &other && isKnownSymmetric())
+        {
+            product.symmetry.store(Symmetry::Symmetric);
+        }
+        else
+        {
+            product.symmetry.store(Symmetry::Unknown);
+        }
+        return product;
+    }
+
+    void BitGraph::multiplyRows(const BitGraph &other, BitGraph &product) const
+    {
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            const Word *cells = row(i);
+            Word *out = product.rowData(i);
+            for (size_t w = 0; w < this->wordsPerRow; w++)
+            {
+                for (Word word = cells[w]; word != 0; word &= word - 1)
+                {
+                    const Word *source = other.row(w * WordBits + static_cast<size_t>(__builtin_ctzll(word)));
+                    for (size_t c = 0; c < this->wordsPerRow; c++)
+                    {
+                        out[c] |= source[c];
+                    }
+                }
+            }
+        }
+    }
+
+    // Method of Four Russians: for every group of 8 rows of other, the ORs of all 256 subsets are
+    // tabulated once, and each row of this graph then adds the whole group with a single lookup
+    void BitGraph::multiplyFourRussians(const BitGraph &other, BitGraph &product) const
+    {
+        const size_t words = this->wordsPerRow;
+        vector<Word> table((size_t(1) << FourRussiansBits) * words, 0);
+        for (size_t base = 0; base < this->vertices; base += FourRussiansBits)
+        {
+            const size_t width = min(FourRussiansBits, this->vertices - base);
+            const size_t subsets = size_t(1) << width;
+            // Each entry extends the entry without its lowest bit by one row
+            for (size_t mask = 1; mask < subsets; mask++)
+            {
+                const Word *smaller = table.data() + (mask & (mask - 1)) * words;
+                const Word *source = other.row(base + static_cast<size_t>(__builtin_ctzll(mask)));
+                Word *entry = table.data() + mask * words;
+                for (size_t c = 0; c < words; c++)
+                {
+                    entry[c] = smaller[c] | source[c];
+                }
+            }
+            // Groups never straddle a word, since FourRussiansBits divides WordBits
+            const size_t word = base / WordBits;
+            const size_t shift = base % WordBits;
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                const size_t mask = static_cast<size_t>(row(i)[word] >> shift) & (subsets - 1);
+                if (mask == 0)
+                {
+                    continue;
+                }
+                const Word *entry = table.data() + mask * words;
+                Word *out = product.rowData(i);
+                for (size_t c = 0; c < words; c++)
+                {
+                    out[c] |= entry[c];
+                }
+            }
+        }
+    }
+
+    size_t BitGraph::countBits() const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            const Word *cells = row(i);
+            for (size_t w = 0; w < this->wordsPerRow; w++)
+            {
+                count += static_cast<size_t>(__builtin_popcountll(cells[w]));
+            }
+        }
+        return count;
+    }
+
+    BitGraph BitGraph::pow(size_t k) const
+    {
+        if (k == 0)
+        {
+            return identity(this->vertices);
+        }
+        // result collects the squares of the set bits of k; it starts at the lowest one
+        BitGraph square = *this;
+        BitGraph result;
+        bool started = false;
+        while (true)
+        {
+            if ((k & 1U) != 0)
+            {
+                result = started ? result * square : square;
+                started = true;
+            }
+            k >>= 1;
+            if (k == 0)
+            {
+                // Powers of the same symmetric matrix commute, so their products stay symmetric
+                if (isKnownSymmetric())
+                {
+                    result.symmetry.store(Symmetry::Symmetric);
+                }
+                return result;
+            }
+            square = square * square;
+        }
+    }
+
+    BitGraph BitGraph::identity(size_t vertices)
+    {
+        BitGraph unit;
+        unit.resize(vertices);
+        for (size_t i = 0; i < vertices; i++)
+        {
+            unit.set(i, i);
+        }
+        return unit;
+    }
+
+    bool BitGraph::hasSymmetricBits() const
+    {
+        return transposed().bits == this->bits;
+    }
+
+    void BitGraph::resize(size_t vertices)
+    {
+        const size_t wordsPerLine = 64 / sizeof(Word);
+        this->vertices = vertices;
+        this->wordsPerRow = wordsFor(vertices);
+        this->stride = (this->wordsPerRow + wordsPerLine - 1) / wordsPerLine * wordsPerLine;
+        this->bits.assign(vertices * this->stride, 0);
+    }
+
+    void BitGraph::set(size_t from, size_t to)
+    {
+        rowData(from)[to / WordBits] |= Word(1) << (to % WordBits);
+    }
+}
@@ -0,0 +1,141 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef BIT_GRAPH_HPP
+#define BIT_GRAPH_HPP
+
+#include "Graph.hpp"
+#include "AlignedAllocator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Unweighted adjacency matrix with one bit per cell.
+     *
+     * Row v holds 64 neighbors per word, so the matrix needs V * V / 8 bytes instead of
+     * V * V * 4, and traversals can expand a whole frontier with word-wide OR and AND-NOT.
+     * Only the edge pattern is kept: every non-zero weight becomes a set bit.
+     */
+    class BitGraph
+    {
+    public:
+        typedef std::uint64_t Word;
+        static const size_t WordBits = 64;
+
+        BitGraph() : vertices(0), wordsPerRow(0), stride(0), symmetry(Symmetry::Symmetric) {}
+
+        /**
+         * @brief Builds the edge pattern of a graph of any storage.
+         *
+         * @param graph The graph to convert; its directedness is kept.
+         */
+        explicit BitGraph(const Graph &graph);
+
+        /**
+         * @brief Loads a square adjacency matrix; non-zero cells become edges.
+         *
+         * @param matrix The adjacency matrix.
+         */
+        void loadGraph(const std::vector<std::vector<int>> &matrix);
+
+        size_t getnumVertices() const;
+        // Scans the bits the first time when no operation could derive the symmetry
+        bool getIsDirected() const;
+        // True when the pattern is known to be symmetric without a scan
+        bool isKnownSymmetric() const { return symmetry.load() == Symmetry::Symmetric; }
+        // Number of words that hold the bits of one row
+        size_t getWordsPerRow() const;
+        bool isAdjacent(size_t from, size_t to) const;
+        // The getWordsPerRow() words of a row; bits past the last vertex are always zero
+        const Word *row(size_t vertex) const;
+
+        /**
+         * @brief Returns the graph with every edge reversed.
+         *
+         * @return The transposed graph.
+         */
+        BitGraph transposed() const;
+
+        /**
+         * @brief Boolean product: cell (i, j) is set when some k has edges i -> k and k -> j.
+         *
+         * Row i of the result is the OR of the rows of other picked by the set bits of row i,
+         * so every step works on 64 columns at once. Dense operands use the Method of Four
+         * Russians instead: the ORs of every subset of 8 rows of other are tabulated, so a row
+         * adds 8 rows of other with one lookup.
+         *
+         * @param other A graph with the same number of vertices.
+         * @return The product. A symmetric graph times itself is known to be symmetric; any other
+         *         product leaves its directedness to be computed on the first getIsDirected().
+         */
+        BitGraph operator*(const BitGraph &other) const;
+
+        /**
+         * @brief Boolean power by repeated squaring, O(log k) products.
+         *
+         * @param k The exponent; pow(0) is the identity.
+         * @return A graph whose cell (i, j) is set when a walk of exactly k edges leads from i to j;
+         *         every power of a symmetric graph is known to be symmetric.
+         */
+        BitGraph pow(size_t k) const;
+
+        // Graph with only the self loops (i, i) set
+        static BitGraph identity(size_t vertices);
+
+        // Number of words needed for one bit per vertex
+        static size_t wordsFor(size_t vertices) { return (vertices + WordBits - 1) / WordBits; }
+
+    private:
+        enum class Symmetry : unsigned char
+        {
+            Unknown,
+            Symmetric,
+            Directed
+        };
+        // One atomic value, so const calls on several threads can fill it without a lock; copies load it
+        class SymmetryCache
+        {
+        public:
+            SymmetryCache(Symmetry value) : value(value) {}
+            SymmetryCache(const SymmetryCache &other) : value(other.load()) {}
+            SymmetryCache &operator=(const SymmetryCache &other)
+            {
+                store(other.load());
+                return *this;
+            }
+            Symmetry load() const { return value.load(std::memory_order_acquire); }
+            void store(Symmetry symmetry) { value.store(symmetry, std::memory_order_release); }
+
+        private:
+            std::atomic<Symmetry> value;
+        };
+
+        // Rows are padded to whole cache lines, like the Graph cell buffer
+        typedef std::vector<Word, AlignedAllocator<Word>> Buffer;
+
+        size_t vertices;
+        size_t wordsPerRow;
+        size_t stride;
+        // Symmetry is cached like in Graph; products that cannot derive it leave it unknown
+        mutable SymmetryCache symmetry;
+        Buffer bits;
+
+        void resize(size_t vertices);
+        Word *rowData(size_t vertex) { return bits.data() + vertex * stride; }
+        void set(size_t from, size_t to);
+        bool hasSymmetricBits() const;
+        size_t countBits() const;
+        // The two product kernels; product must be zeroed and of the same size
+        void multiplyRows(const BitGraph &other, BitGraph &product) const;
+        void multiplyFourRussians(const BitGraph &other, BitGraph &product) const;
+
+        // Rows of other per Four Russians table; it must divide WordBits
+        static const size_t FourRussiansBits = 8;
+    };
+}
+
+#endif
@@ -3,11 +3,18 @@
 // Mail: tsadik88@gmail.com
 
 #include "Graph.hpp"
+#include "BitGraph.hpp"
+#include "SubgraphMatcher.hpp"
+#include "MatrixKernels.hpp"
+#include "ThreadPool.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <climits>
+#include <functional>
 #include <numeric>
 
 using namespace std;
@@ -15,12 +22,79 @@ using namespace std;
 namespace ariel
 {
 
+    // Settings of the parallel graph product
+    size_t Graph::threadCount = 0;
+    size_t Graph::parallelCutoff = 256;
+    size_t Graph::strassenCutoff = 4096;
+    Graph::Overflow Graph::overflowMode = Graph::Overflow::Wrap;
+
+    void Graph::setThreadCount(size_t threads)
+    {
+        threadCount = threads;
+    }
+
+    size_t Graph::getThreadCount()
+    {
+        if (threadCount != 0)
+        {
+            return threadCount;
+        }
+        // hardware_concurrency may report 0 when the number is unknown
+        return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    }
+
+    void Graph::setParallelCutoff(size_t vertices)
+    {
+        parallelCutoff = vertices;
+    }
+
+    size_t Graph::getParallelCutoff()
+    {
+        return parallelCutoff;
+    }
+
+    void Graph::setStrassenCutoff(size_t vertices)
+    {
+        strassenCutoff = vertices;
+    }
+
+    size_t Graph::getStrassenCutoff()
+    {
+        return strassenCutoff;
+    }
+
+    void Graph::setOverflowMode(Overflow mode)
+    {
+        overflowMode = mode;
+    }
+
+    Graph::Overflow Graph::getOverflowMode()
+    {
+        return overflowMode;
+    }
+
+    bool Graph::hasOverflowed() const
+    {
+        return this->overflowed;
+    }
+
+    long long Graph::magnitude() const
+    {
+        const CellStats &cells = cellStats();
+        return std::max(-static_cast<long long>(cells.minWeight), static_cast<long long>(cells.maxWeight));
+    }
+
+    bool Graph::needsWide(long long bound)
+    {
+        return overflowMode != Overflow::Wrap && bound > INT_MAX;
+    }
+
     // Checks if a given matrix is symmetric
     bool Graph::isSimetric(const std::vector<std::vector<int>> &matrix)
     {
         for (size_t i = 0; i < matrix.size(); i++)
         {
-            for (size_t j = 0; j < matrix[i].size(); j++)
+            for (size_t j = i + 1; j < matrix[i].size(); j++)
             {
                 if (matrix[i][j] != matrix[j][i])
                 {
@@ -31,489 +105,2296 @@ namespace ariel
         return true;
     }
 
-    // Loads the graph from a given adjacency matrix
-    void Graph::loadGraph(const std::vector<std::vector<int>> &matrix)
+    // Checks if the stored adjacency matrix is symmetric
+    bool Graph::hasSymmetricCells() const
     {
-        if (matrix.empty())
+        if (this->storage == Storage::Symmetric)
         {
-            throw invalid_argument("Invalid graph: The graph is empty.");
+            return true;
         }
-        for (size_t i = 0; i < matrix.size(); i++)
+        if (this->storage == Storage::Sparse)
         {
-            if (matrix.size() != matrix[i].size())
+            for (size_t i = 0; i < this->vertices; i++)
             {
-                throw invalid_argument("Invalid graph: The graph is not a square matrix.");
+                for (const Edge &edge : neighbors(i))
+                {
+                    if (weightAt(edge.vertex, i) != edge.weight)
+                    {
+                        return false;
+                    }
+                }
             }
+            return true;
         }
-        this->adjacencyMatrix = matrix;
-        this->vertices = matrix.size();
-        this->isDirected = !isSimetric(matrix);
-    }
-
-    // Returns a string representation of the graph
-    std::string Graph::printGraph() const
-    {
-        std::ostringstream os;
-        for (size_t i = 0; i < adjacencyMatrix.size(); ++i)
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            os << "[";
-            for (size_t j = 0; j < adjacencyMatrix[i].size(); ++j)
+            const int *rowI = rowData(i);
+            for (size_t j = i + 1; j < this->vertices; j++)
             {
-                os << adjacencyMatrix[i][j];
-                if (j < adjacencyMatrix[i].size() - 1)
+                if (rowI[j] != rowData(j)[i])
                 {
-                    os << ", ";
+                    return false;
                 }
             }
-            os << "]";
-            if (i < adjacencyMatrix.size() - 1)
+        }
+        return true;
+    }
+
+    // Returns the cached symmetry of the matrix, scanning only if no operator could derive it
+    bool Graph::isSymmetric() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->cache.mutex);
+            if (this->cache.symmetryKnown)
             {
-                os << "\n";
+                return !this->cache.isDirected;
             }
         }
-        return os.str();
+        // Scan without the lock; a thread that finishes first just stores the same answer
+        const bool symmetric = hasSymmetricCells();
+        std::lock_guard<std::mutex> lock(this->cache.mutex);
+        this->cache.isDirected = !symmetric;
+        this->cache.symmetryKnown = true;
+        return symmetric;
     }
 
-    // Returns whether the graph is directed
-    bool Graph::getIsDirected() const
+    bool Graph::isKnownSymmetric() const
     {
-        return this->isDirected;
+        std::lock_guard<std::mutex> lock(this->cache.mutex);
+        return this->cache.symmetryKnown && !this->cache.isDirected;
     }
 
-    // Returns the number of vertices in the graph
-    size_t Graph::getnumVertices() const
+    void Graph::setSymmetry(bool symmetric)
     {
-        return this->vertices;
+        this->cache.isDirected = !symmetric;
+        this->cache.symmetryKnown = true;
     }
 
-    // Returns a constant reference to the adjacency matrix of the graph
-    const std::vector<std::vector<int>> &Graph::getAdjacencyMatrix() const
+    void Graph::forgetSymmetry()
     {
-        return this->adjacencyMatrix;
+        this->cache.symmetryKnown = false;
     }
 
-    // Checks if two vertices are adjacent
-    bool Graph::isAdjacent(size_t vertex1, size_t vertex2) const
+    Graph::Caches::Caches(const Caches &other)
     {
-        if (vertex1 >= this->vertices || vertex2 >= this->vertices)
+        *this = other;
+    }
+
+    Graph::Caches &Graph::Caches::operator=(const Caches &other)
+    {
+        if (this != &other)
         {
-            throw invalid_argument("Invalid vertex: The vertex is out of range.");
+            std::lock_guard<std::mutex> lock(other.mutex);
+            this->isDirected = other.isDirected;
+            this->symmetryKnown = other.symmetryKnown;
+            this->statsValid = other.statsValid;
+            this->stats = other.stats;
+            this->fingerprint = other.fingerprint;
+            this->matrix = other.matrix;
         }
-        return this->adjacencyMatrix[vertex1][vertex2] != 0;
+        return *this;
     }
 
-    // Operator overloading implementations
-
-    // Unary + operator: returns a copy of the graph
-    Graph Graph::operator+() const
+    // Copies only the symmetry; other may be this object
+    void Graph::Caches::copySymmetry(const Caches &other)
     {
-        return *this;
+        std::lock_guard<std::mutex> lock(other.mutex);
+        this->isDirected = other.isDirected;
+        this->symmetryKnown = other.symmetryKnown;
     }
 
-    // Addition operator: adds two graphs element-wise
-    Graph Graph::operator+(const Graph &other) const
+    // Adds one cell to the statistics; zero cells are not edges and are ignored
+    void Graph::CellStats::add(int value)
     {
-        if (this->vertices != other.vertices)
+        if (value == 0)
         {
-            throw invalid_argument("Graphs must be of the same size to add.");
+            return;
         }
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices));
-        for (size_t i = 0; i < this->vertices; ++i)
+        if (this->nonZero == 0)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                result[i][j] = this->adjacencyMatrix[i][j] + other.adjacencyMatrix[i][j];
-            }
+            this->minWeight = value;
+            this->maxWeight = value;
         }
-        Graph sum;
-        sum.loadGraph(result);
-        return sum;
+        else
+        {
+            this->minWeight = std::min(this->minWeight, value);
+            this->maxWeight = std::max(this->maxWeight, value);
+        }
+        this->nonZero++;
     }
 
-    // Addition assignment operator: adds another graph to this graph element-wise
-    Graph &Graph::operator+=(const Graph &other)
+    void Graph::CellStats::addRow(const int *cells, size_t length, size_t diagonal)
     {
-        if (this->vertices != other.vertices)
-        {
-            throw invalid_argument("Graphs must be of the same size to add.");
-        }
-        for (size_t i = 0; i < this->vertices; ++i)
+        addSummary(MatrixKernels::summarize(cells, length), 1);
+        if (cells[diagonal] != 0)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                this->adjacencyMatrix[i][j] += other.adjacencyMatrix[i][j];
-            }
+            this->selfLoops++;
         }
-        return *this;
     }
 
-    // Unary minus operator: negates the adjacency matrix of the graph
-    Graph Graph::operator-() const
+    void Graph::CellStats::addPackedRow(const int *cells, size_t length)
     {
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices));
-        for (size_t i = 0; i < this->vertices; ++i)
+        add(cells[0]);
+        if (cells[0] != 0)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                result[i][j] = -this->adjacencyMatrix[i][j];
-            }
+            this->selfLoops++;
         }
-        Graph negation;
-        negation.loadGraph(result);
-        return negation;
+        // The mirrored cell below the diagonal holds the same weight
+        addSummary(MatrixKernels::summarize(cells + 1, length - 1), 2);
     }
 
-    // Subtraction operator: subtracts another graph from this graph element-wise
-    Graph Graph::operator-(const Graph &other) const
+    // Merges the summary of a run of cells, each counted copies times
+    void Graph::CellStats::addSummary(const MatrixKernels::RunSummary &run, size_t copies)
     {
-        if (this->vertices != other.vertices)
+        if (run.nonZero == 0)
         {
-            throw invalid_argument("Graphs must be of the same size to subtract.");
+            return;
         }
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices));
-        for (size_t i = 0; i < this->vertices; ++i)
+        if (this->nonZero == 0)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                result[i][j] = this->adjacencyMatrix[i][j] - other.adjacencyMatrix[i][j];
-            }
+            this->minWeight = run.minWeight;
+            this->maxWeight = run.maxWeight;
         }
-        Graph difference;
-        difference.loadGraph(result);
-        return difference;
+        else
+        {
+            this->minWeight = std::min(this->minWeight, run.minWeight);
+            this->maxWeight = std::max(this->maxWeight, run.maxWeight);
+        }
+        this->nonZero += run.nonZero * copies;
     }
 
-    // Subtraction assignment operator: subtracts another graph from this graph element-wise
-    Graph &Graph::operator-=(const Graph &other)
+    Graph::CellStats Graph::CellStats::scaled(int scalar) const
     {
-        if (this->vertices != other.vertices)
+        if (scalar == 0)
         {
-            throw invalid_argument("Graphs must be of the same size to subtract.");
+            return CellStats();
         }
-        for (size_t i = 0; i < this->vertices; ++i)
+        CellStats result = *this;
+        result.minWeight = scalar > 0 ? this->minWeight * scalar : this->maxWeight * scalar;
+        result.maxWeight = scalar > 0 ? this->maxWeight * scalar : this->minWeight * scalar;
+        return result;
+    }
+
+    // Scans the stored cells once to rebuild the statistics
+    Graph::CellStats Graph::computeStats() const
+    {
+        CellStats result;
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
+            if (this->storage != Storage::Sparse)
             {
-                this->adjacencyMatrix[i][j] -= other.adjacencyMatrix[i][j];
+                addRunStats(result, i, cellRun(i));
+                continue;
+            }
+            for (const Edge &edge : neighbors(i))
+            {
+                result.add(edge.weight);
+                if (edge.vertex == i)
+                {
+                    result.selfLoops++;
+                }
             }
         }
-        return *this;
+        return result;
     }
 
-    // Pre-increment operator: increments all elements of the adjacency matrix
-    Graph &Graph::operator++()
+    const Graph::CellStats &Graph::cellStats() const
     {
-        for (size_t i = 0; i < this->vertices; ++i)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
+            std::lock_guard<std::mutex> lock(this->cache.mutex);
+            if (this->cache.statsValid)
             {
-                ++this->adjacencyMatrix[i][j];
+                return this->cache.stats;
             }
         }
-        // Set diagonal elements to 0
-        for (size_t i = 0; i < this->vertices; ++i)
+        // Once valid, the statistics only change through non-const calls, so the reference stays good
+        const CellStats computed = computeStats();
+        std::lock_guard<std::mutex> lock(this->cache.mutex);
+        if (!this->cache.statsValid)
         {
-            this->adjacencyMatrix[i][i] = 0;
+            this->cache.stats = computed;
+            this->cache.statsValid = true;
         }
-        return *this;
-    }
-
-    // Post-increment operator: increments all elements of the adjacency matrix and returns the old value
-    Graph Graph::operator++(int)
-    {
-        Graph temp = *this;
-        ++(*this);
-        return temp;
+        return this->cache.stats;
     }
 
-    // Pre-decrement operator: decrements all elements of the adjacency matrix
-    Graph &Graph::operator--()
+    void Graph::addRunStats(CellStats &cells, size_t vertex, const int *run) const
     {
-        for (size_t i = 0; i < this->vertices; ++i)
+        if (this->storage == Storage::Symmetric)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                --this->adjacencyMatrix[i][j];
-            }
+            cells.addPackedRow(run, this->vertices - vertex);
         }
-        // Set diagonal elements to 0
-        for (size_t i = 0; i < this->vertices; ++i)
+        else
         {
-            this->adjacencyMatrix[i][i] = 0;
+            cells.addRow(run, this->vertices, vertex);
         }
-        return *this;
     }
 
-    // Post-decrement operator: decrements all elements of the adjacency matrix and returns the old value
-    Graph Graph::operator--(int)
+    void Graph::setStats(const CellStats &cellStats)
     {
-        Graph temp = *this;
-        --(*this);
-        return temp;
+        this->cache.stats = cellStats;
+        this->cache.statsValid = true;
+        // Every write to the cells ends here or in resize, so the cells and their pattern may have changed
+        this->cache.fingerprint.reset();
+        this->cache.matrix.reset();
     }
 
-    // Scalar multiplication operator: multiplies all elements of the adjacency matrix by a scalar
-    Graph Graph::operator*(int scalar) const
+    // Rounds the row length up to a whole number of 64-byte cache lines
+    size_t Graph::strideFor(size_t vertices)
     {
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices));
-        for (size_t i = 0; i < this->vertices; ++i)
-        {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                result[i][j] = this->adjacencyMatrix[i][j] * scalar;
-            }
-        }
-        Graph product;
-        product.loadGraph(result);
-        return product;
+        const size_t intsPerLine = 64 / sizeof(int);
+        return (vertices + intsPerLine - 1) / intsPerLine * intsPerLine;
     }
 
-    // Scalar multiplication operator (scalar * graph): multiplies all elements of the adjacency matrix by a scalar
-    Graph operator*(int scalar, const Graph &graph)
+    // Allocates a single zeroed dense buffer large enough for the given number of vertices
+    void Graph::resize(size_t vertices)
     {
-        return graph * scalar; // Utilize the existing Graph::operator*(int scalar) const
+        this->vertices = vertices;
+        this->stride = strideFor(vertices);
+        this->storage = Storage::Dense;
+        this->cache.statsValid = false;
+        this->cache.fingerprint.reset();
+        this->cache.matrix.reset();
+        this->cache.symmetryKnown = false;
+        this->overflowed = false;
+        this->adjacencyMatrix.assign(this->stride * vertices, 0);
+        this->rowOffsets.release();
+        this->columnIndices.release();
+        this->edgeWeights.release();
     }
 
-    // Scalar multiplication assignment operator: multiplies all elements of the adjacency matrix by a scalar
-    Graph &Graph::operator*=(int scalar)
+    // Allocates a zeroed packed upper triangle large enough for the given number of vertices
+    void Graph::resizePacked(size_t vertices)
     {
-        for (size_t i = 0; i < this->vertices; ++i)
-        {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                this->adjacencyMatrix[i][j] *= scalar;
-            }
-        }
-        return *this;
+        resize(0);
+        this->vertices = vertices;
+        this->storage = Storage::Symmetric;
+        this->adjacencyMatrix.assign(packedSize(), 0);
     }
 
-    // Scalar division operator: divides all elements of the adjacency matrix by a scalar
-    Graph &Graph::operator/(int scalar)
+    void Graph::resizeLike(const Graph &other)
     {
-        if (scalar == 0)
+        if (other.storage == Storage::Symmetric)
         {
-            throw invalid_argument("Division by zero is not allowed.");
+            resizePacked(other.vertices);
         }
-        for (size_t i = 0; i < this->vertices; ++i)
+        else
         {
-            for (size_t j = 0; j < this->vertices; ++j)
-            {
-                this->adjacencyMatrix[i][j] /= scalar;
-            }
+            resize(other.vertices);
         }
-        return *this;
     }
 
-    // Scalar division assignment operator: divides all elements of the adjacency matrix by a scalar
-    Graph &Graph::operator/=(int scalar)
+    // Builds the CSR arrays from the dense or packed buffer and releases the buffer
+    void Graph::toSparse()
     {
-        if (scalar == 0)
+        if (this->storage == Storage::Sparse)
         {
-            throw invalid_argument("Division by zero is not allowed.");
+            return;
         }
-        for (size_t i = 0; i < this->vertices; ++i)
+        std::vector<size_t> offsets(this->vertices + 1, 0);
+        std::vector<size_t> columns;
+        std::vector<int> weights;
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
+            for (const Edge &edge : neighbors(i))
             {
-                this->adjacencyMatrix[i][j] /= scalar;
+                columns.push_back(edge.vertex);
+                weights.push_back(edge.weight);
             }
+            offsets[i + 1] = columns.size();
         }
-        return *this;
+        this->rowOffsets.adopt(std::move(offsets));
+        this->columnIndices.adopt(std::move(columns));
+        this->edgeWeights.adopt(std::move(weights));
+        this->adjacencyMatrix.release();
+        this->stride = 0;
+        this->storage = Storage::Sparse;
     }
 
-    // Scalar division operator (scalar / graph): divides the scalar by each non-zero element of the adjacency matrix
-    Graph operator/(int scalar, const Graph &graph)
+    // Expands sparse or packed storage into a full dense buffer
+    Graph Graph::expanded() const
     {
-        std::vector<std::vector<int>> result(graph.vertices, std::vector<int>(graph.vertices, 0));
-        for (size_t i = 0; i < graph.vertices; ++i)
+        Graph full;
+        full.resize(this->vertices);
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            for (size_t j = 0; j < graph.vertices; ++j)
+            const int *run = packedRow(i);
+            int *out = full.rowData(i);
+            for (size_t j = i; j < this->vertices; j++)
             {
-                if (i != j && graph.adjacencyMatrix[i][j] != 0)
-                {
-                    result[i][j] = scalar / graph.adjacencyMatrix[i][j];
-                }
+                out[j] = run[j - i];
+                full.rowData(j)[i] = run[j - i];
             }
         }
-        Graph quotient;
-        quotient.loadGraph(result);
-        return quotient;
+        // The cells are the same, so the cached properties are too
+        full.cache = this->cache;
+        full.setSymmetry(true);
+        return full;
     }
 
-    // Graph multiplication operator: multiplies two graphs element-wise
-    Graph Graph::operator*(const Graph &other) const
+    void Graph::toDense()
     {
-        if (this->vertices != other.vertices)
+        if (this->storage == Storage::Dense)
         {
-            throw invalid_argument("The number of columns in the first matrix must be equal to the number of rows in the second matrix.");
+            return;
         }
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices, 0));
-        for (size_t i = 0; i < this->vertices; ++i)
+        if (this->storage == Storage::Symmetric)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
+            Graph full = expanded();
+            this->adjacencyMatrix.swap(full.adjacencyMatrix);
+            this->stride = full.stride;
+            this->storage = Storage::Dense;
+            return;
+        }
+        // Other copies may still share the CSR arrays, so they are only read from here on
+        SharedVector<size_t> sharedOffsets;
+        SharedVector<size_t> sharedColumns;
+        SharedVector<int> sharedWeights;
+        sharedOffsets.swap(this->rowOffsets);
+        sharedColumns.swap(this->columnIndices);
+        sharedWeights.swap(this->edgeWeights);
+        const std::vector<size_t> &offsets = sharedOffsets.read();
+        const std::vector<size_t> &columns = sharedColumns.read();
+        const std::vector<int> &weights = sharedWeights.read();
+        // The cells do not change, so the cached properties survive the conversion
+        const Caches known = this->cache;
+        resize(this->vertices);
+        this->cache = known;
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            int *out = rowData(i);
+            for (size_t e = offsets[i]; e < offsets[i + 1]; e++)
             {
-                for (size_t k = 0; k < this->vertices; ++k)
-                {
-                    result[i][j] += this->adjacencyMatrix[i][k] * other.adjacencyMatrix[k][j];
-                }
-                // Ensure the diagonal elements are set to 0
-                if (i == j)
-                {
-                    result[i][j] = 0;
-                }
+                out[columns[e]] = weights[e];
             }
         }
-        Graph product;
-        product.loadGraph(result);
-        return product;
     }
 
-    // Graph multiplication assignment operator: multiplies this graph by another graph element-wise
-    Graph &Graph::operator*=(const Graph &other)
+    // Drops CSR entries whose weight became zero so the arrays only hold real edges
+    Graph::CellStats Graph::compactSparse()
     {
-        if (this->vertices != other.vertices)
+        // Most operators drop nothing; then the column and offset arrays stay shared with the copies
+        const std::vector<int> &current = this->edgeWeights.read();
+        if (std::find(current.begin(), current.end(), 0) == current.end())
         {
-            throw invalid_argument("Graphs must be of the same size to multiply.");
+            return computeStats();
         }
-
-        std::vector<std::vector<int>> result(this->vertices, std::vector<int>(this->vertices, 0));
-
-        for (size_t i = 0; i < this->vertices; ++i)
+        std::vector<size_t> &offsets = this->rowOffsets.write();
+        std::vector<size_t> &columns = this->columnIndices.write();
+        std::vector<int> &weights = this->edgeWeights.write();
+        CellStats kept;
+        size_t count = 0;
+        size_t rowStart = 0;
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            for (size_t j = 0; j < this->vertices; ++j)
+            size_t rowEnd = offsets[i + 1];
+            for (size_t e = rowStart; e < rowEnd; e++)
             {
-                for (size_t k = 0; k < this->vertices; ++k)
+                if (weights[e] != 0)
                 {
-                    result[i][j] += this->adjacencyMatrix[i][k] * other.adjacencyMatrix[k][j];
+                    columns[count] = columns[e];
+                    weights[count] = weights[e];
+                    kept.add(weights[e]);
+                    if (columns[e] == i)
+                    {
+                        kept.selfLoops++;
+                    }
+                    count++;
                 }
-                if (i == j)
+            }
+            rowStart = rowEnd;
+            offsets[i + 1] = count;
+        }
+        columns.resize(count);
+        weights.resize(count);
+        return kept;
+    }
+
+    // Sorts every CSR row by column, keeps the last of duplicate columns and drops zero weights
+    void Graph::normalizeSparseRows()
+    {
+        std::vector<size_t> &offsets = this->rowOffsets.write();
+        std::vector<size_t> &columns = this->columnIndices.write();
+        std::vector<int> &weights = this->edgeWeights.write();
+        std::vector<std::pair<size_t, int>> scratch;
+        size_t kept = 0;
+        size_t rowStart = 0;
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            size_t rowEnd = offsets[i + 1];
+            scratch.clear();
+            for (size_t e = rowStart; e < rowEnd; e++)
+            {
+                scratch.push_back(std::make_pair(columns[e], weights[e]));
+            }
+            std::stable_sort(scratch.begin(), scratch.end(),
+                             [](const std::pair<size_t, int> &a, const std::pair<size_t, int> &b)
+                             { return a.first < b.first; });
+            for (size_t e = 0; e < scratch.size(); e++)
+            {
+                // Only the last entry of a run of equal columns survives
+                bool last = (e + 1 == scratch.size() || scratch[e + 1].first != scratch[e].first);
+                if (last && scratch[e].second != 0)
                 {
-                    result[i][j] = 0; // Ensure diagonal is zero
+                    columns[kept] = scratch[e].first;
+                    weights[kept] = scratch[e].second;
+                    kept++;
                 }
             }
+            rowStart = rowEnd;
+            offsets[i + 1] = kept;
         }
-
-        this->loadGraph(result);
-        return *this;
+        columns.resize(kept);
+        weights.resize(kept);
+        setStats(computeStats());
+        setSymmetry(hasSymmetricCells());
     }
 
-    bool Graph::isSubgraph(const Graph &other) const
+    // Adds sign * other to this dense graph, touching only other's non-zero cells
+    bool Graph::accumulate(const Graph &other, int sign)
     {
-        if (vertices > other.vertices)
+        bool overflow = false;
+        for (size_t i = 0; i < this->vertices; i++)
         {
-            return false;
+            int *out = rowData(i);
+            for (const Edge &edge : other.neighbors(i))
+            {
+                out[edge.vertex] = narrow(static_cast<long long>(out[edge.vertex]) + sign * static_cast<long long>(edge.weight), overflow);
+            }
         }
+        return overflow;
+    }
 
-        // Create a vector for vertex mapping
-        std::vector<size_t> mapping(other.vertices);
-        std::iota(mapping.begin(), mapping.end(), 0);
-
-        // Try all permutations of the vertex mapping
-        do
+    // Merges the sorted rows of two sparse graphs into left + sign * right
+    Graph Graph::combineSparse(const Graph &left, const Graph &right, int sign)
+    {
+        Graph result;
+        result.resize(0);
+        result.vertices = left.vertices;
+        result.storage = Storage::Sparse;
+        result.rowOffsets.assign(left.vertices + 1, 0);
+        result.columnIndices.reserve(left.columnIndices.size() + right.columnIndices.size());
+        result.edgeWeights.reserve(left.edgeWeights.size() + right.edgeWeights.size());
+        CellStats cells;
+        bool overflow = false;
+        for (size_t i = 0; i < left.vertices; i++)
         {
-            bool is_subgraph = true;
-            for (size_t i = 0; i < vertices && is_subgraph; ++i)
+            size_t a = left.rowOffsets[i];
+            size_t b = right.rowOffsets[i];
+            const size_t aEnd = left.rowOffsets[i + 1];
+            const size_t bEnd = right.rowOffsets[i + 1];
+            while (a < aEnd || b < bEnd)
             {
-                for (size_t j = 0; j < vertices && is_subgraph; ++j)
+                size_t column;
+                long long exact;
+                if (b == bEnd || (a < aEnd && left.columnIndices[a] < right.columnIndices[b]))
                 {
-                    if (adjacencyMatrix[i][j] != 0 && other.adjacencyMatrix[mapping[i]][mapping[j]] == 0)
-                    {
-                        is_subgraph = false;
+                    column = left.columnIndices[a];
+                    exact = left.edgeWeights[a++];
+                }
+                else if (a == aEnd || right.columnIndices[b] < left.columnIndices[a])
+                {
+                    column = right.columnIndices[b];
+                    exact = sign * static_cast<long long>(right.edgeWeights[b++]);
+                }
+                else
+                {
+                    column = left.columnIndices[a];
+                    exact = left.edgeWeights[a++] + sign * static_cast<long long>(right.edgeWeights[b++]);
+                }
+                const int weight = narrow(exact, overflow);
+                if (weight != 0)
+                {
+                    result.columnIndices.push_back(column);
+                    result.edgeWeights.push_back(weight);
+                    cells.add(weight);
+                    if (column == i)
+                    {
+                        cells.selfLoops++;
+                    }
+                }
+            }
+            result.rowOffsets[i + 1] = result.columnIndices.size();
+        }
+        result.setStats(cells);
+        result.overflowed = overflow || left.overflowed || right.overflowed;
+        if (left.isKnownSymmetric() && right.isKnownSymmetric())
+        {
+            result.setSymmetry(true);
+        }
+        return result;
+    }
+
+    // Gustavson's row-by-row product of two sparse graphs: row i of the result is the sum of the rows
+    // of right selected by the edges of row i of left, so the work is proportional to the products formed
+    template <typename Sum>
+    Graph Graph::multiplySparse(const Graph &left, const Graph &right, bool clearDiagonal)
+    {
+        const size_t n = left.vertices;
+        const size_t unused = static_cast<size_t>(-1);
+        Graph result;
+        result.resize(0);
+        result.vertices = n;
+        result.storage = Storage::Sparse;
+        result.rowOffsets.assign(n + 1, 0);
+
+        // Dense accumulator: one sum per column, marked with the row that last wrote it
+        std::vector<Sum> denseSums;
+        std::vector<size_t> denseOwner;
+        std::vector<size_t> touched;
+        // Hash accumulator: open addressing on the column, sized from the row's bound
+        std::vector<size_t> hashColumns;
+        std::vector<Sum> hashSums;
+        std::vector<std::pair<size_t, Sum>> entries;
+        CellStats cells;
+        bool overflow = false;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            // Upper bound on the non-zeros of row i
+            size_t bound = 0;
+            for (size_t a = left.rowOffsets[i]; a < left.rowOffsets[i + 1]; a++)
+            {
+                const size_t k = left.columnIndices[a];
+                bound += right.rowOffsets[k + 1] - right.rowOffsets[k];
+            }
+            entries.clear();
+            if (bound >= n / DenseAccumulatorRatio)
+            {
+                // A row that may reach a large share of the columns: index the sums directly
+                if (denseSums.empty())
+                {
+                    denseSums.assign(n, 0);
+                    denseOwner.assign(n, unused);
+                }
+                for (size_t a = left.rowOffsets[i]; a < left.rowOffsets[i + 1]; a++)
+                {
+                    const size_t k = left.columnIndices[a];
+                    const Sum weight = left.edgeWeights[a];
+                    for (size_t b = right.rowOffsets[k]; b < right.rowOffsets[k + 1]; b++)
+                    {
+                        const size_t column = right.columnIndices[b];
+                        if (denseOwner[column] != i)
+                        {
+                            denseOwner[column] = i;
+                            denseSums[column] = 0;
+                            touched.push_back(column);
+                        }
+                        denseSums[column] += weight * right.edgeWeights[b];
+                    }
+                }
+                for (size_t column : touched)
+                {
+                    entries.push_back(std::make_pair(column, denseSums[column]));
+                }
+                touched.clear();
+            }
+            else if (bound > 0)
+            {
+                // A short row: a table of twice the bound keeps the probe sequences short
+                size_t capacity = 16;
+                while (capacity < 2 * bound)
+                {
+                    capacity *= 2;
+                }
+                if (hashColumns.size() < capacity)
+                {
+                    hashColumns.resize(capacity);
+                    hashSums.resize(capacity);
+                }
+                std::fill(hashColumns.begin(), hashColumns.begin() + static_cast<std::ptrdiff_t>(capacity), unused);
+                const size_t mask = capacity - 1;
+                for (size_t a = left.rowOffsets[i]; a < left.rowOffsets[i + 1]; a++)
+                {
+                    const size_t k = left.columnIndices[a];
+                    const Sum weight = left.edgeWeights[a];
+                    for (size_t b = right.rowOffsets[k]; b < right.rowOffsets[k + 1]; b++)
+                    {
+                        const size_t column = right.columnIndices[b];
+                        size_t slot = (column * 0x9E3779B1U) & mask;
+                        while (hashColumns[slot] != unused && hashColumns[slot] != column)
+                        {
+                            slot = (slot + 1) & mask;
+                        }
+                        if (hashColumns[slot] == unused)
+                        {
+                            hashColumns[slot] = column;
+                            hashSums[slot] = 0;
+                            touched.push_back(slot);
+                        }
+                        hashSums[slot] += weight * right.edgeWeights[b];
+                    }
+                }
+                for (size_t slot : touched)
+                {
+                    entries.push_back(std::make_pair(hashColumns[slot], hashSums[slot]));
+                }
+                touched.clear();
+            }
+
+            // CSR rows are kept in increasing column order; cancelled sums (and the diagonal, if cleared) are dropped
+            std::sort(entries.begin(), entries.end());
+            for (const std::pair<size_t, Sum> &entry : entries)
+            {
+                if (clearDiagonal && entry.first == i)
+                {
+                    continue;
+                }
+                const int weight = narrow(entry.second, overflow);
+                if (weight != 0)
+                {
+                    result.columnIndices.push_back(entry.first);
+                    result.edgeWeights.push_back(weight);
+                    cells.add(weight);
+                    if (entry.first == i)
+                    {
+                        cells.selfLoops++;
+                    }
+                }
+            }
+            result.rowOffsets[i + 1] = result.columnIndices.size();
+        }
+        result.setStats(cells);
+        result.overflowed = overflow || left.overflowed || right.overflowed;
+        return result;
+    }
+
+    // Loads the graph from a given adjacency matrix
+    void Graph::loadGraph(const std::vector<std::vector<int>> &matrix, Storage storage)
+    {
+        if (matrix.empty())
+        {
+            throw invalid_argument("Invalid graph: The graph is empty.");
+        }
+        for (size_t i = 0; i < matrix.size(); i++)
+        {
+            if (matrix.size() != matrix[i].size())
+            {
+                throw invalid_argument("Invalid graph: The graph is not a square matrix.");
+            }
+        }
+        // One scan decides both the layout and the cached symmetry
+        const bool symmetric = isSimetric(matrix);
+        if (storage == Storage::Sparse)
+        {
+            // Build the CSR arrays directly so the dense buffer is never allocated
+            resize(0);
+            this->vertices = matrix.size();
+            this->storage = Storage::Sparse;
+            this->rowOffsets.assign(this->vertices + 1, 0);
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                for (size_t j = 0; j < this->vertices; j++)
+                {
+                    if (matrix[i][j] != 0)
+                    {
+                        this->columnIndices.push_back(j);
+                        this->edgeWeights.push_back(matrix[i][j]);
+                    }
+                }
+                this->rowOffsets[i + 1] = this->columnIndices.size();
+            }
+        }
+        else if (storage != Storage::Dense && symmetric)
+        {
+            // Both triangles are equal, so only the upper one is kept
+            resizePacked(matrix.size());
+            CellStats loaded;
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                std::copy(matrix[i].begin() + static_cast<std::ptrdiff_t>(i), matrix[i].end(), packedRow(i));
+                loaded.addPackedRow(packedRow(i), this->vertices - i);
+            }
+            setStats(loaded);
+        }
+        else if (storage == Storage::Symmetric)
+        {
+            throw invalid_argument("Invalid graph: Symmetric storage needs a symmetric matrix.");
+        }
+        else
+        {
+            resize(matrix.size());
+            CellStats loaded;
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                std::copy(matrix[i].begin(), matrix[i].end(), rowData(i));
+                loaded.addRow(rowData(i), this->vertices, i);
+            }
+            setStats(loaded);
+        }
+        if (!this->cache.statsValid)
+        {
+            setStats(computeStats());
+        }
+        setSymmetry(symmetric);
+    }
+
+    // Loads a sparse graph from an edge list without ever allocating a dense matrix
+    void Graph::loadEdges(size_t vertices, const WeightedEdge *edges, size_t count)
+    {
+        if (vertices == 0)
+        {
+            throw invalid_argument("Invalid graph: The graph is empty.");
+        }
+        for (size_t e = 0; e < count; e++)
+        {
+            if (edges[e].from >= vertices || edges[e].to >= vertices)
+            {
+                throw invalid_argument("Invalid edge: The vertex is out of range.");
+            }
+        }
+        resize(0);
+        this->vertices = vertices;
+        this->storage = Storage::Sparse;
+
+        // Counting sort by source vertex keeps the input order within each row
+        this->rowOffsets.assign(vertices + 1, 0);
+        for (size_t e = 0; e < count; e++)
+        {
+            this->rowOffsets[edges[e].from + 1]++;
+        }
+        for (size_t i = 0; i < vertices; i++)
+        {
+            this->rowOffsets[i + 1] += this->rowOffsets[i];
+        }
+        std::vector<size_t> next(this->rowOffsets.begin(), this->rowOffsets.end() - 1);
+        this->columnIndices.resize(count);
+        this->edgeWeights.resize(count);
+        for (size_t e = 0; e < count; e++)
+        {
+            size_t position = next[edges[e].from]++;
+            this->columnIndices[position] = edges[e].to;
+            this->edgeWeights[position] = edges[e].weight;
+        }
+        normalizeSparseRows();
+    }
+
+    // Loads a sparse graph from an edge list, taking ownership of (and releasing) the list
+    void Graph::loadEdges(size_t vertices, std::vector<WeightedEdge> &&edges)
+    {
+        std::vector<WeightedEdge> owned(std::move(edges));
+        loadEdges(vertices, owned.data(), owned.size());
+    }
+
+    // Loads a sparse graph from the outgoing edge list of every vertex
+    void Graph::loadAdjacencyList(const std::vector<std::vector<Edge>> &adjacency)
+    {
+        if (adjacency.empty())
+        {
+            throw invalid_argument("Invalid graph: The graph is empty.");
+        }
+        size_t count = 0;
+        for (size_t i = 0; i < adjacency.size(); i++)
+        {
+            for (const Edge &edge : adjacency[i])
+            {
+                if (edge.vertex >= adjacency.size())
+                {
+                    throw invalid_argument("Invalid edge: The vertex is out of range.");
+                }
+            }
+            count += adjacency[i].size();
+        }
+        resize(0);
+        this->vertices = adjacency.size();
+        this->storage = Storage::Sparse;
+        this->rowOffsets.assign(this->vertices + 1, 0);
+        this->columnIndices.reserve(count);
+        this->edgeWeights.reserve(count);
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            for (const Edge &edge : adjacency[i])
+            {
+                this->columnIndices.push_back(edge.vertex);
+                this->edgeWeights.push_back(edge.weight);
+            }
+            this->rowOffsets[i + 1] = this->columnIndices.size();
+        }
+        normalizeSparseRows();
+    }
+
+    // Returns a string representation of the graph
+    std::string Graph::printGraph() const
+    {
+        std::ostringstream os;
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            NeighborRange edges = neighbors(i);
+            NeighborIterator next = edges.begin();
+            os << "[";
+            for (size_t j = 0; j < this->vertices; ++j)
+            {
+                if (next != edges.end() && (*next).vertex == j)
+                {
+                    os << (*next).weight;
+                    ++next;
+                }
+                else
+                {
+                    os << 0;
+                }
+                if (j < this->vertices - 1)
+                {
+                    os << ", ";
+                }
+            }
+            os << "]";
+            if (i < this->vertices - 1)
+            {
+                os << "\n";
+            }
+        }
+        return os.str();
+    }
+
+    // Returns whether the graph is directed
+    bool Graph::getIsDirected() const
+    {
+        return !isSymmetric();
+    }
+
+    // Returns the number of vertices in the graph
+    size_t Graph::getnumVertices() const
+    {
+        return this->vertices;
+    }
+
+    // Returns the number of edges; an undirected edge is stored twice but counted once
+    size_t Graph::getNumEdges() const
+    {
+        return countEdges();
+    }
+
+    // Returns whether some edge has a weight other than 1
+    bool Graph::getIsWeighted() const
+    {
+        const CellStats &cells = cellStats();
+        return cells.nonZero > 0 && (cells.minWeight != 1 || cells.maxWeight != 1);
+    }
+
+    bool Graph::hasNegativeWeights() const
+    {
+        return cellStats().minWeight < 0;
+    }
+
+    bool Graph::hasSelfLoops() const
+    {
+        return cellStats().selfLoops > 0;
+    }
+
+    int Graph::getMinWeight() const
+    {
+        return cellStats().minWeight;
+    }
+
+    int Graph::getMaxWeight() const
+    {
+        return cellStats().maxWeight;
+    }
+
+    // Returns the storage backend currently holding the adjacency matrix
+    Graph::Storage Graph::getStorage() const
+    {
+        return this->storage;
+    }
+
+    // Returns a copy of the adjacency matrix of the graph as nested vectors
+    const std::vector<std::vector<int>> &Graph::getAdjacencyMatrix() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->cache.mutex);
+            if (this->cache.matrix)
+            {
+                return *this->cache.matrix;
+            }
+        }
+        std::shared_ptr<const std::vector<std::vector<int>>> computed = std::make_shared<const std::vector<std::vector<int>>>(toMatrix());
+        std::lock_guard<std::mutex> lock(this->cache.mutex);
+        if (!this->cache.matrix)
+        {
+            this->cache.matrix = computed;
+        }
+        return *this->cache.matrix;
+    }
+
+    std::vector<std::vector<int>> Graph::toMatrix() const
+    {
+        std::vector<std::vector<int>> matrix(this->vertices, std::vector<int>(this->vertices, 0));
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            for (const Edge &edge : neighbors(i))
+            {
+                matrix[i][edge.vertex] = edge.weight;
+            }
+        }
+        return matrix;
+    }
+
+    // Returns a read-only view of the outgoing edge weights of a vertex
+    Graph::RowView Graph::row(size_t vertex) const
+    {
+        if (vertex >= this->vertices)
+        {
+            throw invalid_argument("Invalid vertex: The vertex is out of range.");
+        }
+        if (this->storage != Storage::Dense)
+        {
+            throw logic_error("Row views are only available for graphs with full dense storage.");
+        }
+        return RowView(rowData(vertex), this->vertices);
+    }
+
+    // Returns the non-zero outgoing edges of a vertex in increasing order of the target vertex
+    Graph::NeighborRange Graph::neighbors(size_t vertex) const
+    {
+        if (vertex >= this->vertices)
+        {
+            throw invalid_argument("Invalid vertex: The vertex is out of range.");
+        }
+        if (this->storage == Storage::Sparse)
+        {
+            const size_t first = this->rowOffsets[vertex];
+            const size_t last = this->rowOffsets[vertex + 1];
+            return NeighborRange(NeighborIterator(this->edgeWeights.data(), this->columnIndices.data(), first, last),
+                                 NeighborIterator(this->edgeWeights.data(), this->columnIndices.data(), last, last));
+        }
+        if (this->storage == Storage::Symmetric)
+        {
+            // Column 0 of this row is cell (0, vertex) of the upper triangle
+            const int *first = this->adjacencyMatrix.data() + vertex;
+            return NeighborRange(NeighborIterator(first, nullptr, 0, this->vertices, vertex, this->vertices),
+                                 NeighborIterator(first, nullptr, this->vertices, this->vertices, vertex, this->vertices));
+        }
+        return NeighborRange(NeighborIterator(rowData(vertex), nullptr, 0, this->vertices),
+                             NeighborIterator(rowData(vertex), nullptr, this->vertices, this->vertices));
+    }
+
+    // Looks up a cell without range checks; sparse rows are binary searched
+    int Graph::weightAt(size_t vertex1, size_t vertex2) const
+    {
+        if (this->storage == Storage::Sparse)
+        {
+            const size_t *first = this->columnIndices.data() + this->rowOffsets[vertex1];
+            const size_t *last = this->columnIndices.data() + this->rowOffsets[vertex1 + 1];
+            const size_t *found = std::lower_bound(first, last, vertex2);
+            if (found == last || *found != vertex2)
+            {
+                return 0;
+            }
+            return this->edgeWeights[static_cast<size_t>(found - this->columnIndices.data())];
+        }
+        if (this->storage == Storage::Symmetric)
+        {
+            size_t low = std::min(vertex1, vertex2);
+            return packedRow(low)[std::max(vertex1, vertex2) - low];
+        }
+        return rowData(vertex1)[vertex2];
+    }
+
+    // Returns the weight of the edge between two vertices (0 if there is none)
+    int Graph::getEdgeWeight(size_t vertex1, size_t vertex2) const
+    {
+        if (vertex1 >= this->vertices || vertex2 >= this->vertices)
+        {
+            throw invalid_argument("Invalid vertex: The vertex is out of range.");
+        }
+        return weightAt(vertex1, vertex2);
+    }
+
+    // Checks if two vertices are adjacent
+    bool Graph::isAdjacent(size_t vertex1, size_t vertex2) const
+    {
+        return getEdgeWeight(vertex1, vertex2) != 0;
+    }
+
+    // Checks if two graphs hold exactly the same cells, whatever their storage
+    bool Graph::hasSameCells(const Graph &other) const
+    {
+        if (this->vertices != other.vertices)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            if (sharesLayout(other))
+            {
+                if (!std::equal(cellRun(i), cellRun(i) + cellRunLength(i), other.cellRun(i)))
+                {
+                    return false;
+                }
+                continue;
+            }
+            NeighborRange mine = neighbors(i);
+            NeighborRange theirs = other.neighbors(i);
+            NeighborIterator a = mine.begin();
+            NeighborIterator b = theirs.begin();
+            for (; a != mine.end() && b != theirs.end(); ++a, ++b)
+            {
+                if ((*a).vertex != (*b).vertex || (*a).weight != (*b).weight)
+                {
+                    return false;
+                }
+            }
+            if (a != mine.end() || b != theirs.end())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Operator overloading implementations
+
+    // Unary + operator: returns a copy of the graph
+    Graph Graph::operator+() const
+    {
+        return *this;
+    }
+
+    // Addition operator: adds two graphs element-wise
+    Graph Graph::operator+(const Graph &other) const
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to add.");
+        }
+        if (this->storage == Storage::Sparse && other.storage == Storage::Sparse)
+        {
+            return combineSparse(*this, other, 1);
+        }
+        Graph sum;
+        CellStats cells;
+        bool overflow = false;
+        if (sharesLayout(other))
+        {
+            // The cached weight ranges tell whether any cell can leave the int range
+            const bool wide = needsWide(magnitude() + other.magnitude());
+            sum.resizeLike(*this);
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                const int *left = cellRun(i);
+                const int *right = other.cellRun(i);
+                int *out = sum.cellRun(i);
+                if (wide)
+                {
+                    overflow |= MatrixKernels::combineWide(left, right, out, cellRunLength(i), 1, 1, 0, saturating());
+                }
+                else
+                {
+                    MatrixKernels::add(left, right, out, cellRunLength(i));
+                }
+                sum.addRunStats(cells, i, out);
+            }
+        }
+        else
+        {
+            sum.resize(this->vertices);
+            overflow |= sum.accumulate(*this, 1);
+            overflow |= sum.accumulate(other, 1);
+            cells = sum.computeStats();
+        }
+        sum.setStats(cells);
+        sum.overflowed = overflow || this->overflowed || other.overflowed;
+        if (this->isKnownSymmetric() && other.isKnownSymmetric())
+        {
+            sum.setSymmetry(true);
+        }
+        return sum;
+    }
+
+    // Addition assignment operator: adds another graph to this graph element-wise
+    Graph &Graph::operator+=(const Graph &other)
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to add.");
+        }
+        if (!sharesLayout(other))
+        {
+            *this = *this + other;
+            return *this;
+        }
+        CellStats cells;
+        bool overflow = false;
+        const bool wide = needsWide(magnitude() + other.magnitude());
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            int *out = cellRun(i);
+            const int *right = other.cellRun(i);
+            if (wide)
+            {
+                overflow |= MatrixKernels::combineWide(out, right, out, cellRunLength(i), 1, 1, 0, saturating());
+            }
+            else
+            {
+                MatrixKernels::add(out, right, out, cellRunLength(i));
+            }
+            addRunStats(cells, i, out);
+        }
+        setStats(cells);
+        this->overflowed = overflow || this->overflowed || other.overflowed;
+        if (this->isKnownSymmetric() && other.isKnownSymmetric())
+        {
+            setSymmetry(true);
+        }
+        else
+        {
+            forgetSymmetry();
+        }
+        return *this;
+    }
+
+    // Unary minus operator: negates the adjacency matrix of the graph
+    Graph Graph::operator-() const
+    {
+        Graph negation;
+        // Only INT_MIN has no negation
+        const bool wide = needsWide(-static_cast<long long>(cellStats().minWeight));
+        bool overflow = false;
+        if (this->storage == Storage::Sparse)
+        {
+            // The copy shares the CSR structure; only the weights are rewritten
+            negation = *this;
+            for (int &weight : negation.edgeWeights.write())
+            {
+                weight = narrow(-static_cast<long long>(weight), overflow);
+            }
+        }
+        else
+        {
+            negation.resizeLike(*this);
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                const int *source = cellRun(i);
+                int *out = negation.cellRun(i);
+                if (wide)
+                {
+                    overflow |= MatrixKernels::combineWide(source, nullptr, out, cellRunLength(i), -1, 0, 0, saturating());
+                }
+                else
+                {
+                    MatrixKernels::negate(source, out, cellRunLength(i));
+                }
+            }
+        }
+        // Negation keeps every zero and every pair of equal cells, so the properties carry over,
+        // except for the weight range when there is an INT_MIN to wrap or clamp
+        negation.setStats(magnitude() > INT_MAX ? negation.computeStats() : cellStats().scaled(-1));
+        negation.overflowed = overflow || this->overflowed;
+        negation.cache.copySymmetry(this->cache);
+        return negation;
+    }
+
+    // Subtraction operator: subtracts another graph from this graph element-wise
+    Graph Graph::operator-(const Graph &other) const
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to subtract.");
+        }
+        if (this->storage == Storage::Sparse && other.storage == Storage::Sparse)
+        {
+            return combineSparse(*this, other, -1);
+        }
+        Graph difference;
+        CellStats cells;
+        bool overflow = false;
+        if (sharesLayout(other))
+        {
+            // The cached weight ranges tell whether any cell can leave the int range
+            const bool wide = needsWide(magnitude() + other.magnitude());
+            difference.resizeLike(*this);
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                const int *left = cellRun(i);
+                const int *right = other.cellRun(i);
+                int *out = difference.cellRun(i);
+                if (wide)
+                {
+                    overflow |= MatrixKernels::combineWide(left, right, out, cellRunLength(i), 1, -1, 0, saturating());
+                }
+                else
+                {
+                    MatrixKernels::subtract(left, right, out, cellRunLength(i));
+                }
+                difference.addRunStats(cells, i, out);
+            }
+        }
+        else
+        {
+            difference.resize(this->vertices);
+            overflow |= difference.accumulate(*this, 1);
+            overflow |= difference.accumulate(other, -1);
+            cells = difference.computeStats();
+        }
+        difference.setStats(cells);
+        difference.overflowed = overflow || this->overflowed || other.overflowed;
+        if (this->isKnownSymmetric() && other.isKnownSymmetric())
+        {
+            difference.setSymmetry(true);
+        }
+        return difference;
+    }
+
+    // Subtraction assignment operator: subtracts another graph from this graph element-wise
+    Graph &Graph::operator-=(const Graph &other)
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to subtract.");
+        }
+        if (!sharesLayout(other))
+        {
+            *this = *this - other;
+            return *this;
+        }
+        CellStats cells;
+        bool overflow = false;
+        const bool wide = needsWide(magnitude() + other.magnitude());
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            int *out = cellRun(i);
+            const int *right = other.cellRun(i);
+            if (wide)
+            {
+                overflow |= MatrixKernels::combineWide(out, right, out, cellRunLength(i), 1, -1, 0, saturating());
+            }
+            else
+            {
+                MatrixKernels::subtract(out, right, out, cellRunLength(i));
+            }
+            addRunStats(cells, i, out);
+        }
+        setStats(cells);
+        this->overflowed = overflow || this->overflowed || other.overflowed;
+        if (this->isKnownSymmetric() && other.isKnownSymmetric())
+        {
+            setSymmetry(true);
+        }
+        else
+        {
+            forgetSymmetry();
+        }
+        return *this;
+    }
+
+    // Replaces this graph with minuend - this, in place when the layouts match
+    Graph &Graph::subtractFrom(const Graph &minuend)
+    {
+        if (this->vertices != minuend.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to subtract.");
+        }
+        if (!sharesLayout(minuend))
+        {
+            *this = minuend - *this;
+            return *this;
+        }
+        CellStats cells;
+        bool overflow = false;
+        const bool wide = needsWide(magnitude() + minuend.magnitude());
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            int *out = cellRun(i);
+            if (wide)
+            {
+                overflow |= MatrixKernels::combineWide(minuend.cellRun(i), out, out, cellRunLength(i), 1, -1, 0, saturating());
+            }
+            else
+            {
+                MatrixKernels::subtract(minuend.cellRun(i), out, out, cellRunLength(i));
+            }
+            addRunStats(cells, i, out);
+        }
+        setStats(cells);
+        this->overflowed = overflow || this->overflowed || minuend.overflowed;
+        if (this->isKnownSymmetric() && minuend.isKnownSymmetric())
+        {
+            setSymmetry(true);
+        }
+        else
+        {
+            forgetSymmetry();
+        }
+        return *this;
+    }
+
+    // Operators on expiring operands: the result takes over the operand's buffer and is updated in place
+    Graph operator+(Graph &&left, const Graph &right)
+    {
+        left += right;
+        return std::move(left);
+    }
+
+    Graph operator+(const Graph &left, Graph &&right)
+    {
+        // Addition is commutative, so the right operand's buffer can hold the sum
+        right += left;
+        return std::move(right);
+    }
+
+    Graph operator+(Graph &&left, Graph &&right)
+    {
+        left += right;
+        return std::move(left);
+    }
+
+    Graph operator-(Graph &&left, const Graph &right)
+    {
+        left -= right;
+        return std::move(left);
+    }
+
+    Graph operator-(const Graph &left, Graph &&right)
+    {
+        right.subtractFrom(left);
+        return std::move(right);
+    }
+
+    Graph operator-(Graph &&left, Graph &&right)
+    {
+        left -= right;
+        return std::move(left);
+    }
+
+    Graph operator-(Graph &&graph)
+    {
+        graph *= -1;
+        return std::move(graph);
+    }
+
+    Graph operator*(Graph &&graph, int scalar)
+    {
+        graph *= scalar;
+        return std::move(graph);
+    }
+
+    Graph operator*(int scalar, Graph &&graph)
+    {
+        graph *= scalar;
+        return std::move(graph);
+    }
+
+    // Writes source + delta into every off-diagonal cell of this graph, which has the same dense or packed layout;
+    // source may be this graph
+    void Graph::shiftFrom(const Graph &source, int delta)
+    {
+        CellStats cells;
+        bool overflow = false;
+        const bool wide = needsWide(source.magnitude() + 1);
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            int *out = cellRun(i);
+            if (wide)
+            {
+                overflow |= MatrixKernels::combineWide(source.cellRun(i), nullptr, out, cellRunLength(i), 1, 0, delta, saturating());
+            }
+            else
+            {
+                MatrixKernels::addScalar(source.cellRun(i), out, cellRunLength(i), delta);
+            }
+            // Set diagonal elements to 0
+            out[diagonalInRun(i)] = 0;
+            addRunStats(cells, i, out);
+        }
+        // Shifting every off-diagonal cell by the same amount keeps the symmetry unchanged
+        setStats(cells);
+        this->overflowed = overflow || source.overflowed;
+        this->cache.copySymmetry(source.cache);
+    }
+
+    // Post-increment and post-decrement: the old cells move into the returned graph and the shifted
+    // cells are written into a new buffer, so the old value is never copied
+    Graph Graph::shifted(int delta)
+    {
+        Graph old(std::move(*this));
+        if (old.storage == Storage::Sparse)
+        {
+            resize(old.vertices);
+            accumulate(old, 1);
+            shiftFrom(*this, delta);
+            this->cache.copySymmetry(old.cache);
+        }
+        else
+        {
+            resizeLike(old);
+            shiftFrom(old, delta);
+        }
+        return old;
+    }
+
+    // Pre-increment operator: increments all elements of the adjacency matrix
+    // Every off-diagonal cell may become non-zero, so a sparse graph is converted to dense storage
+    Graph &Graph::operator++()
+    {
+        if (this->storage == Storage::Sparse)
+        {
+            toDense();
+        }
+        shiftFrom(*this, 1);
+        return *this;
+    }
+
+    // Post-increment operator: increments all elements of the adjacency matrix and returns the old value
+    Graph Graph::operator++(int)
+    {
+        return shifted(1);
+    }
+
+    // Pre-decrement operator: decrements all elements of the adjacency matrix
+    // Every off-diagonal cell may become non-zero, so a sparse graph is converted to dense storage
+    Graph &Graph::operator--()
+    {
+        if (this->storage == Storage::Sparse)
+        {
+            toDense();
+        }
+        shiftFrom(*this, -1);
+        return *this;
+    }
+
+    // Post-decrement operator: decrements all elements of the adjacency matrix and returns the old value
+    Graph Graph::operator--(int)
+    {
+        return shifted(-1);
+    }
+
+    // Scalar multiplication operator: multiplies all elements of the adjacency matrix by a scalar
+    Graph Graph::operator*(int scalar) const
+    {
+        if (this->storage == Storage::Sparse)
+        {
+            Graph product = *this;
+            product *= scalar;
+            return product;
+        }
+        Graph product;
+        product.resizeLike(*this);
+        const long long bound = magnitude() * std::abs(static_cast<long long>(scalar));
+        const bool wide = needsWide(bound);
+        // Cells that wrap or clamp can become zero or change order, so their statistics are rebuilt
+        const bool exact = bound <= INT_MAX;
+        bool overflow = false;
+        CellStats cells;
+        for (size_t i = 0; i < this->vertices; ++i)
+        {
+            const int *source = cellRun(i);
+            int *out = product.cellRun(i);
+            if (wide)
+            {
+                overflow |= MatrixKernels::combineWide(source, nullptr, out, cellRunLength(i), scalar, 0, 0, saturating());
+            }
+            else
+            {
+                MatrixKernels::multiplyScalar(source, out, cellRunLength(i), scalar);
+            }
+            if (!exact)
+            {
+                product.addRunStats(cells, i, out);
+            }
+        }
+        // Without overflow, a non-zero scalar keeps zeros and equal pairs of cells, so only the weight range changes
+        product.setStats(exact ? cellStats().scaled(scalar) : cells);
+        product.overflowed = overflow || this->overflowed;
+        if (scalar == 0)
+        {
+            product.setSymmetry(true);
+        }
+        else
+        {
+            product.cache.copySymmetry(this->cache);
+        }
+        return product;
+    }
+
+    // Scalar multiplication operator (scalar * graph): multiplies all elements of the adjacency matrix by a scalar
+    Graph operator*(int scalar, const Graph &graph)
+    {
+        return graph * scalar; // Utilize the existing Graph::operator*(int scalar) const
+    }
+
+    // Scalar multiplication assignment operator: multiplies all elements of the adjacency matrix by a scalar
+    Graph &Graph::operator*=(int scalar)
+    {
+        // Without overflow, a non-zero scalar keeps zeros and equal pairs of cells, so only the weight range changes;
+        // cells that wrap or clamp can become zero or change order, so their statistics are rebuilt
+        const long long bound = magnitude() * std::abs(static_cast<long long>(scalar));
+        const bool wide = needsWide(bound);
+        const bool exact = bound <= INT_MAX;
+        CellStats cells = exact ? cellStats().scaled(scalar) : CellStats();
+        bool overflow = false;
+        if (this->storage == Storage::Sparse)
+        {
+            for (int &weight : this->edgeWeights.write())
+            {
+                weight = narrow(static_cast<long long>(weight) * scalar, overflow);
+            }
+            CellStats kept = compactSparse();
+            if (!exact)
+            {
+                cells = kept;
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                int *out = cellRun(i);
+                if (wide)
+                {
+                    overflow |= MatrixKernels::combineWide(out, nullptr, out, cellRunLength(i), scalar, 0, 0, saturating());
+                }
+                else
+                {
+                    MatrixKernels::multiplyScalar(out, out, cellRunLength(i), scalar);
+                }
+                if (!exact)
+                {
+                    addRunStats(cells, i, out);
+                }
+            }
+        }
+        setStats(cells);
+        this->overflowed = this->overflowed || overflow;
+        if (scalar == 0)
+        {
+            setSymmetry(true);
+        }
+        return *this;
+    }
+
+    // Scalar division operator: divides all elements of the adjacency matrix by a scalar
+    Graph &Graph::operator/(int scalar)
+    {
+        return *this /= scalar;
+    }
+
+    // Scalar division assignment operator: divides all elements of the adjacency matrix by a scalar
+    Graph &Graph::operator/=(int scalar)
+    {
+        if (scalar == 0)
+        {
+            throw invalid_argument("Division by zero is not allowed.");
+        }
+        // INT_MIN / -1 is the only quotient outside the int range
+        const bool wide = scalar == -1 && needsWide(magnitude());
+        bool overflow = false;
+        // The magic multiplier is computed once and reused by every row
+        const MatrixKernels::Reciprocal divisor(scalar);
+        if (this->storage == Storage::Sparse)
+        {
+            std::vector<int> &weights = this->edgeWeights.write();
+            if (wide)
+            {
+                overflow = MatrixKernels::combineWide(weights.data(), nullptr, weights.data(), weights.size(), -1, 0, 0, saturating());
+            }
+            else
+            {
+                MatrixKernels::divideScalar(weights.data(), weights.data(), weights.size(), divisor);
+            }
+            setStats(compactSparse());
+        }
+        else
+        {
+            CellStats cells;
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                int *out = cellRun(i);
+                if (wide)
+                {
+                    overflow |= MatrixKernels::combineWide(out, nullptr, out, cellRunLength(i), -1, 0, 0, saturating());
+                }
+                else
+                {
+                    MatrixKernels::divideScalar(out, out, cellRunLength(i), divisor);
+                }
+                addRunStats(cells, i, out);
+            }
+            setStats(cells);
+        }
+        this->overflowed = this->overflowed || overflow;
+        // Truncation can make two different cells equal, so only symmetry is guaranteed to survive
+        if (!isKnownSymmetric())
+        {
+            forgetSymmetry();
+        }
+        return *this;
+    }
+
+    // Scalar division operator (scalar / graph): divides the scalar by each non-zero element of the adjacency matrix
+    Graph operator/(int scalar, const Graph &graph)
+    {
+        Graph quotient;
+        // INT_MIN / -1 is the only quotient outside the int range
+        bool overflow = false;
+        if (graph.storage == Graph::Storage::Sparse)
+        {
+            quotient = graph;
+            const std::vector<size_t> &offsets = graph.rowOffsets.read();
+            const std::vector<size_t> &columns = graph.columnIndices.read();
+            std::vector<int> &weights = quotient.edgeWeights.write();
+            for (size_t i = 0; i < quotient.vertices; ++i)
+            {
+                for (size_t e = offsets[i]; e < offsets[i + 1]; ++e)
+                {
+                    weights[e] = (columns[e] == i) ? 0 : Graph::narrow(static_cast<long long>(scalar) / weights[e], overflow);
+                }
+            }
+            quotient.setStats(quotient.compactSparse());
+        }
+        else
+        {
+            quotient.resizeLike(graph);
+            Graph::CellStats cells;
+            for (size_t i = 0; i < graph.vertices; ++i)
+            {
+                const int *source = graph.cellRun(i);
+                int *out = quotient.cellRun(i);
+                const size_t diagonal = graph.diagonalInRun(i);
+                for (size_t j = 0; j < graph.cellRunLength(i); ++j)
+                {
+                    if (j != diagonal && source[j] != 0)
+                    {
+                        out[j] = Graph::narrow(static_cast<long long>(scalar) / source[j], overflow);
                     }
                 }
+                quotient.addRunStats(cells, i, out);
             }
-            if (is_subgraph)
+            quotient.setStats(cells);
+        }
+        quotient.overflowed = overflow || graph.overflowed;
+        if (graph.isKnownSymmetric())
+        {
+            quotient.setSymmetry(true);
+        }
+        else
+        {
+            quotient.forgetSymmetry();
+        }
+        return quotient;
+    }
+
+    // Graph multiplication operator: multiplies two graphs element-wise
+    Graph Graph::operator*(const Graph &other) const
+    {
+        return multiplyArithmetic(other, true);
+    }
+
+    Graph Graph::multiplyArithmetic(const Graph &other, bool clearDiagonal) const
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("The number of columns in the first matrix must be equal to the number of rows in the second matrix.");
+        }
+        // A symmetric graph times itself is symmetric, (A * A)^T = A^T * A^T = A * A, and so is a product with an empty graph
+        const bool symmetric = (this == &other && isKnownSymmetric()) || cellStats().nonZero == 0 || other.cellStats().nonZero == 0;
+        // No sum of a row can exceed V products of the largest magnitudes; the int kernels are used when that fits in an int
+        const __int128 bound = static_cast<__int128>(magnitude()) * other.magnitude() * static_cast<__int128>(this->vertices);
+        const bool wide = overflowMode != Overflow::Wrap && bound > INT_MAX;
+        const bool hugeSums = bound > LLONG_MAX;
+        // Two sparse operands give a sparse product without ever allocating a dense buffer
+        if (this->storage == Storage::Sparse && other.storage == Storage::Sparse)
+        {
+            Graph product = !wide ? multiplySparse<int>(*this, other, clearDiagonal)
+                                  : (hugeSums ? multiplySparse<__int128>(*this, other, clearDiagonal) : multiplySparse<long long>(*this, other, clearDiagonal));
+            if (symmetric)
             {
-                return true;
+                product.setSymmetry(true);
+            }
+            return product;
+        }
+        Graph product;
+        product.resize(this->vertices);
+        CellStats cells;
+        bool overflow = false;
+        if (this->storage != Storage::Sparse && other.storage != Storage::Sparse)
+        {
+            // The kernel walks full rows, so packed operands are expanded first
+            Graph leftFull;
+            Graph rightFull;
+            const Graph &left = (this->storage == Storage::Symmetric) ? (leftFull = expanded(), leftFull) : *this;
+            const Graph &right = (other.storage == Storage::Symmetric) ? (rightFull = other.expanded(), rightFull) : other;
+            const int *leftCells = left.adjacencyMatrix.data();
+            const int *rightCells = right.adjacencyMatrix.data();
+            int *productCells = product.adjacencyMatrix.data();
+            const size_t order = this->vertices;
+            const size_t stride = product.stride;
+            const bool parallel = order >= parallelCutoff && getThreadCount() > 1;
+            if (wide)
+            {
+                const bool saturate = saturating();
+                if (!parallel)
+                {
+                    overflow = MatrixKernels::multiplyWide(leftCells, rightCells, productCells, order, stride, 0, order, saturate, hugeSums);
+                }
+                else
+                {
+                    std::atomic<bool> seen(false);
+                    std::atomic<bool> *flag = &seen;
+                    const size_t rowBlock = 64;
+                    ThreadPool::shared(getThreadCount()).parallelFor(order, rowBlock, [=](size_t begin, size_t end)
+                                                                     {
+                        if (MatrixKernels::multiplyWide(leftCells, rightCells, productCells, order, stride, begin, end, saturate, hugeSums))
+                        {
+                            flag->store(true);
+                        } });
+                    overflow = seen;
+                }
+            }
+            else if (strassenCutoff != 0 && order >= strassenCutoff)
+            {
+                const size_t leafSize = std::max<size_t>(strassenCutoff / 8, 64);
+                MatrixKernels::multiplyStrassen(leftCells, rightCells, productCells, order, stride, leafSize,
+                                                parallel ? &ThreadPool::shared(getThreadCount()) : nullptr);
             }
-        } while (std::next_permutation(mapping.begin(), mapping.end()));
+            else if (!parallel)
+            {
+                MatrixKernels::multiply(leftCells, rightCells, productCells, order, stride, 0, order);
+            }
+            else
+            {
+                // Every thread writes its own blocks of result rows, so no synchronization is needed
+                const size_t rowBlock = 64;
+                ThreadPool::shared(getThreadCount()).parallelFor(order, rowBlock, [=](size_t begin, size_t end)
+                                                                 { MatrixKernels::multiply(leftCells, rightCells, productCells, order, stride, begin, end); });
+            }
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                int *out = product.rowData(i);
+                if (clearDiagonal)
+                {
+                    out[i] = 0;
+                }
+                cells.addRow(out, this->vertices, i);
+            }
+        }
+        else
+        {
+            // Row i of the product only depends on the rows of other reached by row i's edges
+            std::vector<__int128> sums(wide ? this->vertices : 0);
+            for (size_t i = 0; i < this->vertices; ++i)
+            {
+                int *out = product.rowData(i);
+                for (const Edge &left : neighbors(i))
+                {
+                    for (const Edge &right : other.neighbors(left.vertex))
+                    {
+                        if (wide)
+                        {
+                            sums[right.vertex] += static_cast<__int128>(left.weight) * right.weight;
+                        }
+                        else
+                        {
+                            out[right.vertex] += left.weight * right.weight;
+                        }
+                    }
+                }
+                if (wide)
+                {
+                    for (size_t j = 0; j < this->vertices; ++j)
+                    {
+                        out[j] = narrow(sums[j], overflow);
+                        sums[j] = 0;
+                    }
+                }
+                if (clearDiagonal)
+                {
+                    out[i] = 0;
+                }
+                cells.addRow(out, this->vertices, i);
+            }
+        }
+        // Otherwise the symmetry of a product is not implied by its factors; it is computed on demand
+        product.setStats(cells);
+        product.overflowed = overflow || this->overflowed || other.overflowed;
+        if (symmetric)
+        {
+            product.setSymmetry(true);
+        }
+        return product;
+    }
 
-        return false;
+    // Graph multiplication assignment operator: multiplies this graph by another graph element-wise
+    Graph &Graph::operator*=(const Graph &other)
+    {
+        if (this->vertices != other.vertices)
+        {
+            throw invalid_argument("Graphs must be of the same size to multiply.");
+        }
+        *this = *this * other;
+        return *this;
     }
 
-    bool Graph::operator<(const Graph &other) const
+    Graph Graph::identity() const
     {
-        // Check if this graph is a subgraph of the other
-        if (this->isSubgraph(other) && !other.isSubgraph(*this))
+        Graph unit;
+        if (this->storage == Storage::Sparse)
         {
-            return true;
+            unit.resize(0);
+            unit.vertices = this->vertices;
+            unit.storage = Storage::Sparse;
+            std::vector<size_t> offsets(this->vertices + 1);
+            std::iota(offsets.begin(), offsets.end(), 0);
+            std::vector<size_t> columns(this->vertices);
+            std::iota(columns.begin(), columns.end(), 0);
+            unit.rowOffsets.adopt(std::move(offsets));
+            unit.columnIndices.adopt(std::move(columns));
+            unit.edgeWeights.adopt(std::vector<int>(this->vertices, 1));
         }
+        else
+        {
+            unit.resize(this->vertices);
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                unit.rowData(i)[i] = 1;
+            }
+        }
+        CellStats cells;
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            cells.add(1);
+        }
+        cells.selfLoops = this->vertices;
+        unit.setStats(cells);
+        unit.setSymmetry(true);
+        return unit;
+    }
 
-        // Check if the other graph is a subgraph of this one
-        if (other.isSubgraph(*this) && !this->isSubgraph(other))
+    Graph Graph::multiply(const Graph &other, Semiring semiring) const
+    {
+        if (this->vertices != other.vertices)
         {
-            return false;
+            throw invalid_argument("Graphs must be of the same size to multiply.");
+        }
+        if (semiring == Semiring::Boolean)
+        {
+            // Squaring multiplies one pattern by itself, so a symmetric graph keeps its known symmetry
+            const BitGraph left(*this);
+            return fromBits(this == &other ? left * left : left * BitGraph(other), this->storage == Storage::Sparse && other.storage == Storage::Sparse);
+        }
+        if (semiring == Semiring::MinPlus)
+        {
+            bool overflow = false;
+            Graph product = fromDistances(multiplyMinPlus(distances(), other.distances(), this->vertices, overflow), this->vertices);
+            if (this == &other && isKnownSymmetric())
+            {
+                product.setSymmetry(true);
+            }
+            // Walk weights are always clamped; only the modes that check report it
+            product.overflowed = (overflow && overflowMode != Overflow::Wrap) || this->overflowed || other.overflowed;
+            return product;
         }
+        return multiplyArithmetic(other, false);
+    }
 
-        // Compare number of edges
-        size_t thisEdges = this->countEdges();
-        size_t otherEdges = other.countEdges();
-        if (thisEdges != otherEdges)
+    // Exponentiation by squaring: A^k is the product of the squares A^(2^b) for the set bits b of k
+    Graph Graph::pow(size_t k, Semiring semiring) const
+    {
+        if (semiring == Semiring::Boolean)
         {
-            return thisEdges < otherEdges;
+            return fromBits(BitGraph(*this).pow(k), this->storage == Storage::Sparse);
         }
+        Graph result;
+        if (semiring == Semiring::MinPlus)
+        {
+            // The squares stay distance matrices, so a walk of weight 0 is only folded into "no edge" at the end
+            Buffer square = distances();
+            Buffer walks;
+            bool started = false;
+            bool overflow = false;
+            for (size_t bits = k; bits != 0; bits >>= 1)
+            {
+                if ((bits & 1U) != 0)
+                {
+                    walks = started ? multiplyMinPlus(walks, square, this->vertices, overflow) : square;
+                    started = true;
+                }
+                if (bits > 1)
+                {
+                    square = multiplyMinPlus(square, square, this->vertices, overflow);
+                }
+            }
+            if (started)
+            {
+                result = fromDistances(walks, this->vertices);
+                result.overflowed = (overflow && overflowMode != Overflow::Wrap) || this->overflowed;
+            }
+            else
+            {
+                // Zero edges reach only the vertex itself, at cost 0: the graph without edges
+                result.resize(this->vertices);
+                result.setStats(CellStats());
+            }
+        }
+        else if (k == 0)
+        {
+            return identity();
+        }
+        else
+        {
+            Graph square = *this;
+            bool started = false;
+            for (size_t bits = k; bits != 0; bits >>= 1)
+            {
+                if ((bits & 1U) != 0)
+                {
+                    result = started ? result.multiplyArithmetic(square, false) : square;
+                    started = true;
+                }
+                if (bits > 1)
+                {
+                    square = square.multiplyArithmetic(square, false);
+                }
+            }
+        }
+        // Every power of a symmetric matrix is symmetric
+        if (isKnownSymmetric())
+        {
+            result.setSymmetry(true);
+        }
+        return result;
+    }
 
-        // If number of edges is the same, compare number of vertices
-        return this->vertices < other.vertices;
+    Graph Graph::booleanPow(size_t k) const
+    {
+        return pow(k, Semiring::Boolean);
     }
 
-    size_t Graph::countEdges() const
+    Graph Graph::fromBits(const BitGraph &pattern, bool sparse)
     {
-        size_t count = 0;
-        if (isSimetric(this->adjacencyMatrix))
+        const size_t order = pattern.getnumVertices();
+        const size_t words = pattern.getWordsPerRow();
+        Graph result;
+        if (sparse)
         {
-            for (size_t i = 0; i < this->vertices; ++i)
+            result.resize(0);
+            result.vertices = order;
+            result.storage = Storage::Sparse;
+            result.rowOffsets.assign(order + 1, 0);
+        }
+        else
+        {
+            result.resize(order);
+        }
+        CellStats cells;
+        for (size_t i = 0; i < order; i++)
+        {
+            const BitGraph::Word *bits = pattern.row(i);
+            for (size_t w = 0; w < words; w++)
             {
-                for (size_t j = 0; j < this->vertices; ++j)
+                for (BitGraph::Word word = bits[w]; word != 0; word &= word - 1)
                 {
-                    if (this->adjacencyMatrix[i][j] != 0)
+                    const size_t j = w * BitGraph::WordBits + static_cast<size_t>(__builtin_ctzll(word));
+                    if (sparse)
+                    {
+                        result.columnIndices.push_back(j);
+                        result.edgeWeights.push_back(1);
+                    }
+                    else
+                    {
+                        result.rowData(i)[j] = 1;
+                    }
+                    cells.add(1);
+                    if (j == i)
                     {
-                        count++;
+                        cells.selfLoops++;
                     }
                 }
             }
-            count = count / 2;
+            if (sparse)
+            {
+                result.rowOffsets[i + 1] = result.columnIndices.size();
+            }
+        }
+        result.setStats(cells);
+        // Only a symmetry the pattern already knows is copied; otherwise the graph finds it when asked
+        if (pattern.isKnownSymmetric())
+        {
+            result.setSymmetry(true);
         }
         else
         {
-            for (size_t i = 0; i < this->vertices; ++i)
+            result.forgetSymmetry();
+        }
+        return result;
+    }
+
+    Graph::Buffer Graph::distances() const
+    {
+        const size_t stride = strideFor(this->vertices);
+        Buffer cells;
+        cells.assign(stride * this->vertices, MatrixKernels::Unreachable);
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            int *row = cells.data() + i * stride;
+            for (const Edge &edge : neighbors(i))
             {
-                for (size_t j = 0; j < this->vertices; ++j)
+                row[edge.vertex] = edge.weight;
+            }
+            // Staying at a vertex costs nothing, unless a negative self loop is lighter
+            row[i] = std::min(row[i], 0);
+        }
+        return cells;
+    }
+
+    Graph::Buffer Graph::multiplyMinPlus(const Buffer &left, const Buffer &right, size_t vertices, bool &overflow)
+    {
+        const size_t stride = strideFor(vertices);
+        Buffer product;
+        product.assign(stride * vertices, MatrixKernels::Unreachable);
+        const int *leftCells = left.data();
+        const int *rightCells = right.data();
+        int *productCells = product.data();
+        if (vertices < parallelCutoff || getThreadCount() == 1)
+        {
+            overflow |= MatrixKernels::multiplyMinPlus(leftCells, rightCells, productCells, vertices, stride, 0, vertices);
+        }
+        else
+        {
+            std::atomic<bool> seen(false);
+            std::atomic<bool> *flag = &seen;
+            const size_t rowBlock = 64;
+            ThreadPool::shared(getThreadCount()).parallelFor(vertices, rowBlock, [=](size_t begin, size_t end)
+                                                             {
+                if (MatrixKernels::multiplyMinPlus(leftCells, rightCells, productCells, vertices, stride, begin, end))
                 {
-                    if (this->adjacencyMatrix[i][j] != 0)
-                    {
-                        count++;
-                    }
-                }
+                    flag->store(true);
+                } });
+            overflow |= seen;
+        }
+        return product;
+    }
+
+    Graph Graph::fromDistances(const Buffer &cells, size_t vertices)
+    {
+        Graph result;
+        result.resize(vertices);
+        CellStats stats;
+        for (size_t i = 0; i < vertices; i++)
+        {
+            const int *row = cells.data() + i * result.stride;
+            int *out = result.rowData(i);
+            for (size_t j = 0; j < vertices; j++)
+            {
+                out[j] = (row[j] == MatrixKernels::Unreachable) ? 0 : row[j];
+            }
+            stats.addRow(out, vertices, i);
+        }
+        result.setStats(stats);
+        return result;
+    }
+
+    // Mixes a 64-bit value so that sums of mixed colors rarely collide (splitmix64 finalizer)
+    static std::uint64_t mixColor(std::uint64_t value)
+    {
+        value += 0x9e3779b97f4a7c15ull;
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
+    }
+
+    // True when the i-th largest value of small never exceeds the i-th largest value of large
+    static bool isDominated(const std::vector<size_t> &small, const std::vector<size_t> &large)
+    {
+        for (size_t i = 0; i < small.size(); i++)
+        {
+            if (small[i] > large[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const Graph::Fingerprint &Graph::fingerprint() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->cache.mutex);
+            if (this->cache.fingerprint)
+            {
+                return *this->cache.fingerprint;
+            }
+        }
+        std::shared_ptr<const Fingerprint> computed = std::make_shared<const Fingerprint>(computeFingerprint());
+        std::lock_guard<std::mutex> lock(this->cache.mutex);
+        if (!this->cache.fingerprint)
+        {
+            this->cache.fingerprint = computed;
+        }
+        return *this->cache.fingerprint;
+    }
+
+    Graph::Fingerprint Graph::computeFingerprint() const
+    {
+        Fingerprint result;
+        result.outDegrees.assign(this->vertices, 0);
+        result.inDegrees.assign(this->vertices, 0);
+        result.selfLoops = cellStats().selfLoops;
+        // The edge pattern as plain lists, read once
+        std::vector<std::pair<size_t, size_t>> edges;
+        edges.reserve(cellStats().nonZero);
+        for (size_t i = 0; i < this->vertices; i++)
+        {
+            for (const Edge &edge : neighbors(i))
+            {
+                edges.push_back(std::make_pair(i, edge.vertex));
+                result.outDegrees[i]++;
+                result.inDegrees[edge.vertex]++;
+            }
+        }
+
+        // Every vertex starts with a color for whether it has a self loop; each round recolors a vertex
+        // from its color and the multisets of its out- and in-neighbors' colors, until the number of
+        // color classes stops growing
+        std::vector<std::uint64_t> colors(this->vertices, 0);
+        for (const std::pair<size_t, size_t> &edge : edges)
+        {
+            if (edge.first == edge.second)
+            {
+                colors[edge.first] = 1;
+            }
+        }
+        std::vector<std::uint64_t> outgoing(this->vertices);
+        std::vector<std::uint64_t> incoming(this->vertices);
+        std::vector<std::uint64_t> sorted;
+        size_t classes = 0;
+        while (true)
+        {
+            sorted = colors;
+            std::sort(sorted.begin(), sorted.end());
+            const size_t distinct = static_cast<size_t>(std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+            if (distinct == classes)
+            {
+                break;
+            }
+            classes = distinct;
+            std::fill(outgoing.begin(), outgoing.end(), 0);
+            std::fill(incoming.begin(), incoming.end(), 0);
+            // Sums of mixed colors do not depend on the order of the neighbors
+            for (const std::pair<size_t, size_t> &edge : edges)
+            {
+                outgoing[edge.first] += mixColor(colors[edge.second]);
+                incoming[edge.second] += mixColor(colors[edge.first] ^ 0x5555555555555555ull);
+            }
+            for (size_t i = 0; i < this->vertices; i++)
+            {
+                colors[i] = mixColor(colors[i] ^ mixColor(outgoing[i] + mixColor(incoming[i])));
+            }
+        }
+        // The multiset of final colors, independent of the vertex numbering
+        std::sort(colors.begin(), colors.end());
+        result.colors = mixColor(this->vertices);
+        for (std::uint64_t color : colors)
+        {
+            result.colors = mixColor(result.colors ^ color);
+        }
+        std::sort(result.outDegrees.begin(), result.outDegrees.end(), std::greater<size_t>());
+        std::sort(result.inDegrees.begin(), result.inDegrees.end(), std::greater<size_t>());
+        return result;
+    }
+
+    bool Graph::isSubgraph(const Graph &other) const
+    {
+        // A copy needs at least as many edges as the graph has
+        if (vertices > other.vertices || cellStats().nonZero > other.cellStats().nonZero)
+        {
+            return false;
+        }
+        // The cached invariants rule out most pairs before any search
+        const Fingerprint &mine = fingerprint();
+        const Fingerprint &theirs = other.fingerprint();
+        if (mine.selfLoops > theirs.selfLoops || !isDominated(mine.outDegrees, theirs.outDegrees) || !isDominated(mine.inDegrees, theirs.inDegrees))
+        {
+            return false;
+        }
+        // With as many vertices and edges, a copy is an isomorphism, which keeps the refined colors
+        if (vertices == other.vertices && cellStats().nonZero == other.cellStats().nonZero)
+        {
+            if (mine.colors != theirs.colors)
+            {
+                return false;
+            }
+            if (hasSameCells(other))
+            {
+                return true;
             }
-            count = count;
+        }
+        // Large searches split their subtrees between the threads of the shared pool
+        const bool parallel = other.vertices >= parallelCutoff && getThreadCount() > 1;
+        return SubgraphMatcher(*this, other).find(parallel ? &ThreadPool::shared(getThreadCount()) : nullptr);
+    }
+
+    int Graph::compare(const Graph &other) const
+    {
+        if (this == &other || hasSameCells(other))
+        {
+            return 0;
+        }
+        // Each direction of the subgraph test is searched once
+        const bool inOther = this->isSubgraph(other);
+        const bool containsOther = other.isSubgraph(*this);
+
+        // A graph that is a subgraph of the other, but not the other way around, is smaller
+        if (inOther != containsOther)
+        {
+            return inOther ? -1 : 1;
+        }
+
+        // Compare number of edges
+        size_t thisEdges = this->countEdges();
+        size_t otherEdges = other.countEdges();
+        if (thisEdges != otherEdges)
+        {
+            return thisEdges < otherEdges ? -1 : 1;
+        }
+
+        // If number of edges is the same, compare number of vertices
+        if (this->vertices != other.vertices)
+        {
+            return this->vertices < other.vertices ? -1 : 1;
+        }
+        return 0;
+    }
+
+    bool Graph::operator<(const Graph &other) const
+    {
+        return compare(other) < 0;
+    }
+
+    // Returns the cached edge count; a symmetric matrix stores each edge twice
+    size_t Graph::countEdges() const
+    {
+        size_t count = cellStats().nonZero;
+        if (isSymmetric())
+        {
+            count = count / 2;
         }
         return count;
     }
 
     bool Graph::operator>(const Graph &other) const
     {
-        return other < *this;
+        return compare(other) > 0;
     }
 
     bool Graph::operator==(const Graph &other) const
     {
-        return this->adjacencyMatrix == other.adjacencyMatrix || (!(*this < other) && !(other < *this));
+        return compare(other) == 0;
     }
 
     bool Graph::operator<=(const Graph &other) const
     {
-        return !(*this > other);
+        return compare(other) <= 0;
     }
 
     bool Graph::operator>=(const Graph &other) const
     {
-        return !(*this < other);
+        return compare(other) >= 0;
     }
 
     bool Graph::operator!=(const Graph &other) const
     {
-        return !(*this == other);
+        return compare(other) != 0;
     }
 
     // Output stream operator: prints the graph
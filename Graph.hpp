@@ -5,26 +5,166 @@
 #ifndef GRAPH_HPP
 #define GRAPH_HPP
 
+#include "AlignedAllocator.hpp"
+#include "MatrixKernels.hpp"
+#include "SharedVector.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <iostream>
 #include <string>
 
 namespace ariel
 {
+    // Lazy element-wise expressions, see GraphExpression.hpp
+    template <typename Derived>
+    class GraphExpression;
+    class GraphTerm;
+    class BitGraph;
 
     class Graph
     {
     public:
+        // How the adjacency matrix is kept in memory
+        enum class Storage
+        {
+            Dense,     // Full row-major matrix, O(V^2) memory
+            Sparse,    // Compressed sparse row (CSR) arrays, O(V + E) memory
+            Symmetric, // Packed upper triangle of a symmetric matrix, V(V+1)/2 cells
+            Auto       // loadGraph only: Symmetric for a symmetric matrix, Dense otherwise; never reported by getStorage
+        };
+
+        // An outgoing edge: the target vertex and the edge weight
+        struct Edge
+        {
+            size_t vertex;
+            int weight;
+        };
+
+        // A directed edge of an edge list, used to build a graph without a dense matrix
+        struct WeightedEdge
+        {
+            size_t from;
+            size_t to;
+            int weight;
+        };
+
+        // Iterates over the non-zero cells of one row, in increasing column order
+        class NeighborIterator
+        {
+        public:
+            // Sparse rows pass the CSR arrays and position indexes them.
+            // Dense rows pass columns == nullptr, weights points at the cell of column position and
+            // zero cells are skipped. In a packed upper triangle the cells left of the diagonal are
+            // read from the column above it, so the pointer steps by (order - column - 1) until it
+            // reaches the diagonal at column pivot, and by one from there on.
+            NeighborIterator(const int *weights, const size_t *columns, size_t position, size_t last, size_t pivot = 0, size_t order = 0)
+                : weights(weights), columns(columns), position(position), last(last), pivot(pivot), order(order)
+            {
+                skipZeros();
+            }
+
+            Edge operator*() const { return columns != nullptr ? Edge{columns[position], weights[position]} : Edge{position, *weights}; }
+            NeighborIterator &operator++()
+            {
+                advance();
+                skipZeros();
+                return *this;
+            }
+            bool operator==(const NeighborIterator &other) const { return position == other.position; }
+            bool operator!=(const NeighborIterator &other) const { return position != other.position; }
+
+        private:
+            void advance()
+            {
+                if (columns == nullptr)
+                {
+                    weights += (position < pivot) ? order - position - 1 : 1;
+                }
+                ++position;
+            }
+
+            void skipZeros()
+            {
+                while (columns == nullptr && position < last && *weights == 0)
+                {
+                    advance();
+                }
+            }
+
+            const int *weights;
+            const size_t *columns;
+            size_t position;
+            size_t last;
+            size_t pivot;
+            size_t order;
+        };
+
+        // Range of the outgoing edges of a vertex, usable in a range-based for loop
+        class NeighborRange
+        {
+        public:
+            NeighborRange(NeighborIterator first, NeighborIterator last) : first(first), last(last) {}
+
+            NeighborIterator begin() const { return first; }
+            NeighborIterator end() const { return last; }
+
+        private:
+            NeighborIterator first;
+            NeighborIterator last;
+        };
+
+        // Read-only view of one row of the adjacency matrix
+        class RowView
+        {
+        public:
+            RowView(const int *cells, size_t length) : cells(cells), length(length) {}
+
+            size_t size() const { return length; }
+            const int &operator[](size_t column) const { return cells[column]; }
+            const int *begin() const { return cells; }
+            const int *end() const { return cells + length; }
+
+        private:
+            const int *cells;
+            size_t length;
+        };
+
         // Constructors
-        Graph() : vertices(0), isDirected(false), isWeighted(false) {}
+        Graph() : vertices(0), stride(0), overflowed(false), storage(Storage::Dense) {}
+        // Evaluates a lazy expression such as lazy(g1) + g2 - 3 * lazy(g3) in a single pass
+        template <typename Derived>
+        Graph(const GraphExpression<Derived> &expression);
 
         // Member functions
-        void loadGraph(const std::vector<std::vector<int>> &matrix);
+        void loadGraph(const std::vector<std::vector<int>> &matrix, Storage storage = Storage::Dense);
+        // Builds a sparse graph from an edge list; later duplicates of an edge overwrite earlier ones
+        void loadEdges(size_t vertices, const WeightedEdge *edges, size_t count);
+        void loadEdges(size_t vertices, std::vector<WeightedEdge> &&edges);
+        // Builds a sparse graph from per-vertex lists of outgoing edges
+        void loadAdjacencyList(const std::vector<std::vector<Edge>> &adjacency);
         std::string printGraph() const;
 
         bool getIsDirected() const;
         size_t getnumVertices() const;
+        // Cached properties, maintained by loadGraph and the operators so each query is O(1)
+        size_t getNumEdges() const;
+        bool getIsWeighted() const;
+        bool hasNegativeWeights() const;
+        bool hasSelfLoops() const;
+        int getMinWeight() const; // Smallest non-zero weight, 0 for a graph without edges
+        int getMaxWeight() const; // Largest non-zero weight, 0 for a graph without edges
+        Storage getStorage() const;
+        // Nested copy of the cells, built by the first call and kept until the graph is written.
+        // row(), neighbors() and getEdgeWeight() read the cells in place and are preferred.
         const std::vector<std::vector<int>> &getAdjacencyMatrix() const;
+        // A new nested copy of the cells on every call, O(V^2)
+        std::vector<std::vector<int>> toMatrix() const;
+        // Only available for full dense storage, the loadGraph default; other storages throw std::logic_error
+        RowView row(size_t vertex) const;
+        NeighborRange neighbors(size_t vertex) const;
+        int getEdgeWeight(size_t vertex1, size_t vertex2) const;
         bool isAdjacent(size_t vertex1, size_t vertex2) const;
 
         // Operator overloads
@@ -36,11 +176,12 @@ namespace ariel
         Graph operator-(const Graph &other) const;
         Graph &operator-=(const Graph &other);
 
+        // ++ and -- shift every off-diagonal cell, so a sparse graph becomes dense
         Graph &operator++();   // Pre-increment
-        Graph operator++(int); // Post-increment
+        Graph operator++(int); // Post-increment; the old cells move into the returned graph instead of being copied
 
         Graph &operator--();   // Pre-decrement
-        Graph operator--(int); // Post-decrement
+        Graph operator--(int); // Post-decrement, like post-increment
 
         Graph operator*(int scalar) const;
         Graph &operator*=(int scalar);
@@ -51,6 +192,29 @@ namespace ariel
         Graph operator*(const Graph &other) const;
         Graph &operator*=(const Graph &other);
 
+        // How multiply and pow combine the walks i -> k -> j into cell (i, j)
+        enum class Semiring
+        {
+            Arithmetic, // (+, *): the sum of the walk weights, as in operator*
+            Boolean,    // (OR, AND): 1 when some walk exists, computed 64 columns at a time on the bit pattern
+            MinPlus     // (min, +): the lightest walk; every vertex also reaches itself at cost 0
+        };
+        // The product of this graph and other over a semiring. Unlike operator*, the diagonal is kept.
+        // MinPlus results are dense, and a lightest walk of total weight 0 reads as no edge. A MinPlus walk weight
+        // outside the int range is clamped to INT_MIN or INT_MAX - 1 in every overflow mode, since a wrapped
+        // weight would win or lose the minimum by accident; Saturate and Check also flag it, see hasOverflowed().
+        Graph multiply(const Graph &other, Semiring semiring) const;
+
+        // Matrix power by repeated squaring, O(log k) products: cell (i, j) combines the walks of exactly k edges
+        // (at most k edges for MinPlus, so pow(V - 1, Semiring::MinPlus) gives all-pairs shortest paths).
+        // Unlike operator*, the diagonal is kept, so closed walks show up as self loops; pow(0) is the identity.
+        Graph pow(size_t k, Semiring semiring = Semiring::Arithmetic) const;
+        // Same as pow(k, Semiring::Boolean)
+        Graph booleanPow(size_t k) const;
+
+        template <typename Derived>
+        Graph &operator=(const GraphExpression<Derived> &expression);
+
         bool operator==(const Graph &other) const;
         bool operator!=(const Graph &other) const;
         bool operator<(const Graph &other) const;
@@ -64,17 +228,228 @@ namespace ariel
         friend Graph operator/(int scalar, const Graph &graph);
         // Scalar multiplication operator (scalar * graph)
         friend Graph operator*(int scalar, const Graph &graph);
+        // Overloads for expiring operands, e.g. std::move(g1) + g2 or -(g1 + g2): the result reuses the operand's buffer
+        friend Graph operator+(Graph &&left, const Graph &right);
+        friend Graph operator+(const Graph &left, Graph &&right);
+        friend Graph operator+(Graph &&left, Graph &&right);
+        friend Graph operator-(Graph &&left, const Graph &right);
+        friend Graph operator-(const Graph &left, Graph &&right);
+        friend Graph operator-(Graph &&left, Graph &&right);
+        friend Graph operator-(Graph &&graph);
+        friend Graph operator*(Graph &&graph, int scalar);
+        friend Graph operator*(int scalar, Graph &&graph);
         static bool isSimetric(const std::vector<std::vector<int>> &matrix);
 
+        // Threads used by the dense graph product; 0 (the default) uses every hardware thread
+        static void setThreadCount(size_t threads);
+        static size_t getThreadCount();
+        // Products, and subgraph searches in graphs, with fewer vertices than this run on the calling thread only
+        static void setParallelCutoff(size_t vertices);
+        static size_t getParallelCutoff();
+        // Dense products of graphs with at least this many vertices (4096 by default) use Strassen's
+        // recursion down to blocks of max(cutoff / 8, 64) vertices; 0 turns it off
+        static void setStrassenCutoff(size_t vertices);
+        static size_t getStrassenCutoff();
+
+        // What the arithmetic operators and the (+, *) product do when a cell leaves the int range
+        enum class Overflow
+        {
+            Wrap,     // The cell wraps around like plain int arithmetic (the default)
+            Saturate, // The cell is clamped to INT_MIN or INT_MAX
+            Check     // The cell wraps and the result is flagged, see hasOverflowed()
+        };
+        // Saturate and Check only switch to the widened 64-bit kernels when the cached weight ranges
+        // of the operands show that a cell could leave the int range, so there is no separate scan
+        static void setOverflowMode(Overflow mode);
+        static Overflow getOverflowMode();
+        // True when a cell of this graph, or of a graph it was computed from, left the int range under Saturate or Check
+        bool hasOverflowed() const;
+
     private:
+        friend class GraphTerm;
+        template <typename Left, typename Right, typename Operation>
+        friend class GraphBinaryExpression;
+        template <typename Operand>
+        friend class GraphScaledExpression;
+        friend class GraphSorter;
+
+        // Contiguous cell storage; rows are padded to a multiple of a cache line.
+        // Copies of a graph share their arrays until one of them is written to.
+        typedef SharedVector<int, AlignedAllocator<int>> Buffer;
+
         // Method to check if this graph is a subgraph of another graph
         bool isSubgraph(const Graph &other) const;
+        // Orders two graphs for the comparison operators: negative, zero or positive like strcmp
+        int compare(const Graph &other) const;
+        // Statistics over the non-zero cells of the adjacency matrix
+        struct CellStats
+        {
+            CellStats() : nonZero(0), selfLoops(0), minWeight(0), maxWeight(0) {}
+
+            void add(int value);
+            // Adds a whole row; diagonal is the column that belongs to the diagonal
+            void addRow(const int *cells, size_t length, size_t diagonal);
+            // Adds a row of the packed upper triangle starting at the diagonal; the other cells count twice
+            void addPackedRow(const int *cells, size_t length);
+            // Adds a run summarized by MatrixKernels::summarize, every cell counted copies times
+            void addSummary(const MatrixKernels::RunSummary &run, size_t copies);
+            // Statistics after every cell is multiplied by a scalar; only valid when no product leaves the int range
+            CellStats scaled(int scalar) const;
+
+            size_t nonZero;
+            size_t selfLoops;
+            int minWeight;
+            int maxWeight;
+        };
+
         size_t vertices;
-        bool isDirected;
-        bool isWeighted;
-        std::vector<std::vector<int>> adjacencyMatrix;
+        size_t stride;
+        // Invariants of the edge pattern that isomorphic graphs share; weights are ignored
+        struct Fingerprint
+        {
+            // Sorted, largest first
+            std::vector<size_t> outDegrees;
+            std::vector<size_t> inDegrees;
+            size_t selfLoops;
+            // Hash of the vertex colors after Weisfeiler-Lehman refinement
+            std::uint64_t colors;
+        };
+        // Properties filled in by the first const query that needs them. Const calls on one graph may
+        // run on several threads, so those calls read and fill the caches under the mutex; writers
+        // go without it, since a graph must not be written while another thread uses it.
+        struct Caches
+        {
+            Caches() : isDirected(false), symmetryKnown(true), statsValid(true) {}
+            // Copies take the source's mutex and get a mutex of their own
+            Caches(const Caches &other);
+            Caches &operator=(const Caches &other);
+            void copySymmetry(const Caches &other);
+
+            // Symmetry is cached; operators that cannot derive it cheaply leave it unknown until asked
+            bool isDirected;
+            bool symmetryKnown;
+            bool statsValid;
+            CellStats stats;
+            // Computed by the first comparison and dropped with the statistics; copies share it
+            std::shared_ptr<const Fingerprint> fingerprint;
+            // Built by getAdjacencyMatrix and dropped like the fingerprint
+            std::shared_ptr<const std::vector<std::vector<int>>> matrix;
+            mutable std::mutex mutex;
+        };
+        mutable Caches cache;
+        bool overflowed;
+        Storage storage;
+        Buffer adjacencyMatrix;
+        // CSR arrays: the edges of row i are at [rowOffsets[i], rowOffsets[i + 1]). Scalar operators
+        // rewrite only the weights, so their results keep sharing the offsets and columns.
+        SharedVector<size_t> rowOffsets;
+        SharedVector<size_t> columnIndices;
+        SharedVector<int> edgeWeights;
+
+        // Number of ints per row, rounded up so every row starts on a cache line
+        static size_t strideFor(size_t vertices);
+        // Allocates a zeroed buffer for the given number of vertices
+        void resize(size_t vertices);
+        // Allocates a zeroed packed upper triangle for the given number of vertices
+        void resizePacked(size_t vertices);
+        int *rowData(size_t vertex) { return adjacencyMatrix.data() + vertex * stride; }
+        const int *rowData(size_t vertex) const { return adjacencyMatrix.data() + vertex * stride; }
+        // Index of cell (row, row) in the packed upper triangle; row i holds columns i..V-1
+        static size_t packedOffset(size_t vertices, size_t row) { return row * (2 * vertices - row + 1) / 2; }
+        int *packedRow(size_t vertex) { return adjacencyMatrix.data() + packedOffset(vertices, vertex); }
+        const int *packedRow(size_t vertex) const { return adjacencyMatrix.data() + packedOffset(vertices, vertex); }
+        size_t packedSize() const { return vertices * (vertices + 1) / 2; }
+        // Dense and packed storage keep every row as one contiguous run of cells:
+        // the whole row for dense storage, the cells from the diagonal on for packed storage
+        int *cellRun(size_t vertex) { return storage == Storage::Symmetric ? packedRow(vertex) : rowData(vertex); }
+        const int *cellRun(size_t vertex) const { return storage == Storage::Symmetric ? packedRow(vertex) : rowData(vertex); }
+        size_t cellRunLength(size_t vertex) const { return storage == Storage::Symmetric ? vertices - vertex : vertices; }
+        size_t diagonalInRun(size_t vertex) const { return storage == Storage::Symmetric ? 0 : vertex; }
+        void addRunStats(CellStats &cells, size_t vertex, const int *run) const;
+        // Allocates a zeroed buffer with the same dense or packed layout as other
+        void resizeLike(const Graph &other);
+        // True when both graphs use the same contiguous layout, so their runs line up cell by cell
+        bool sharesLayout(const Graph &other) const { return storage == other.storage && storage != Storage::Sparse; }
+        bool hasSymmetricCells() const;
+        bool isSymmetric() const;
+        // True only when symmetry is already cached, so it never triggers a scan
+        bool isKnownSymmetric() const;
+        void setSymmetry(bool symmetric);
+        void forgetSymmetry();
+        const CellStats &cellStats() const;
+        CellStats computeStats() const;
+        void setStats(const CellStats &cellStats);
+        // Unchecked cell lookup that works for every storage
+        int weightAt(size_t vertex1, size_t vertex2) const;
+        // Builds the CSR arrays from the dense buffer and releases the buffer
+        void toSparse();
+        // Expands sparse or packed storage into a full dense buffer
+        void toDense();
+        // Full dense copy of a packed graph, written straight from the triangle
+        Graph expanded() const;
+        // Drops CSR entries whose weight became zero and returns the statistics of the kept ones
+        CellStats compactSparse();
+        // Sorts every CSR row by column, keeps the last of duplicate columns and drops zeros
+        void normalizeSparseRows();
+        // Adds sign * other to this dense graph, touching only other's non-zero cells; returns whether a cell overflowed
+        bool accumulate(const Graph &other, int sign);
+        bool hasSameCells(const Graph &other) const;
+        Graph &subtractFrom(const Graph &minuend);
+        void shiftFrom(const Graph &source, int delta);
+        Graph shifted(int delta);
+        // Row-by-row merge of two sparse graphs into left + sign * right
+        static Graph combineSparse(const Graph &left, const Graph &right, int sign);
+        // Matrix product over (+, *); operator* clears the diagonal of the result, pow keeps it
+        Graph multiplyArithmetic(const Graph &other, bool clearDiagonal) const;
+        // Gustavson's row-by-row product of two sparse graphs into sums of type Sum; the result is sparse
+        // and the cost follows the number of two-hop paths instead of V^3
+        template <typename Sum>
+        static Graph multiplySparse(const Graph &left, const Graph &right, bool clearDiagonal);
+        // Identity matrix of the same order, sparse when this graph is sparse and dense otherwise
+        Graph identity() const;
+        // 0/1 graph with the edges of a bit pattern, sparse or dense
+        static Graph fromBits(const BitGraph &pattern, bool sparse);
+        // Min-plus operand with the dense stride: no edge is MatrixKernels::Unreachable and the diagonal is at most 0
+        Buffer distances() const;
+        // Sets overflow when some walk weight had to be clamped
+        static Buffer multiplyMinPlus(const Buffer &left, const Buffer &right, size_t vertices, bool &overflow);
+        // Dense graph of a min-plus result; unreachable cells become 0
+        static Graph fromDistances(const Buffer &cells, size_t vertices);
+        // Rows whose product may touch at least 1/DenseAccumulatorRatio of the columns use a dense accumulator
+        static const size_t DenseAccumulatorRatio = 16;
 
         size_t countEdges() const;
+        const Fingerprint &fingerprint() const;
+        Fingerprint computeFingerprint() const;
+        // Writes every cell of an expression once, row by row, into a new buffer
+        template <typename Expression>
+        void evaluate(const Expression &expression);
+
+        static size_t threadCount;
+        static size_t parallelCutoff;
+        static size_t strassenCutoff;
+        static Overflow overflowMode;
+        // Largest magnitude of a cell, from the cached statistics
+        long long magnitude() const;
+        // True when cells up to bound in magnitude need the widened kernels under the current mode
+        static bool needsWide(long long bound);
+        static bool saturating() { return overflowMode == Overflow::Saturate; }
+        // Narrows an exact value to a cell under the current mode; sets overflow when it is out of range and the mode is not Wrap
+        template <typename Sum>
+        static int narrow(Sum value, bool &overflow)
+        {
+            const int wrapped = static_cast<int>(static_cast<unsigned int>(value));
+            if (overflowMode == Overflow::Wrap || (value >= INT_MIN && value <= INT_MAX))
+            {
+                return wrapped;
+            }
+            overflow = true;
+            if (overflowMode == Overflow::Saturate)
+            {
+                return value > 0 ? INT_MAX : INT_MIN;
+            }
+            return wrapped;
+        }
     };
 
 } // namespace ariel
@@ -0,0 +1,55 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+// GraphBuilder.cpp
+#include "GraphBuilder.hpp"
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace ariel
+{
+    GraphBuilder::GraphBuilder(size_t vertices) : vertices(vertices)
+    {
+        if (vertices == 0)
+        {
+            throw invalid_argument("Invalid graph: The graph is empty.");
+        }
+    }
+
+    GraphBuilder &GraphBuilder::reserve(size_t edges)
+    {
+        this->edges.reserve(edges);
+        return *this;
+    }
+
+    GraphBuilder &GraphBuilder::addEdge(size_t from, size_t to, int weight)
+    {
+        if (from >= this->vertices || to >= this->vertices)
+        {
+            throw invalid_argument("Invalid edge: The vertex is out of range.");
+        }
+        this->edges.push_back(Graph::WeightedEdge{from, to, weight});
+        return *this;
+    }
+
+    GraphBuilder &GraphBuilder::addUndirectedEdge(size_t vertex1, size_t vertex2, int weight)
+    {
+        addEdge(vertex1, vertex2, weight);
+        if (vertex1 != vertex2)
+        {
+            addEdge(vertex2, vertex1, weight);
+        }
+        return *this;
+    }
+
+    Graph GraphBuilder::build()
+    {
+        Graph graph;
+        graph.loadEdges(this->vertices, std::move(this->edges));
+        this->edges.clear();
+        return graph;
+    }
+}
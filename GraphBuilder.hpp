@@ -0,0 +1,72 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef GRAPH_BUILDER_HPP
+#define GRAPH_BUILDER_HPP
+
+#include "Graph.hpp"
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Collects edges one at a time and builds a sparse Graph from them.
+     *
+     * The edges are kept as a flat edge list, so building a graph with V vertices
+     * and E edges needs O(V + E) memory and never allocates a V x V matrix.
+     */
+    class GraphBuilder
+    {
+    public:
+        /**
+         * @brief Creates a builder for a graph with the given number of vertices.
+         *
+         * @param vertices The number of vertices of the graph to build.
+         */
+        explicit GraphBuilder(size_t vertices);
+
+        /**
+         * @brief Reserves room for the expected number of edges.
+         *
+         * @param edges The number of edges that will be added.
+         * @return A reference to this builder.
+         */
+        GraphBuilder &reserve(size_t edges);
+
+        /**
+         * @brief Adds a directed edge. Adding the same edge again overwrites its weight.
+         *
+         * @param from The source vertex.
+         * @param to The target vertex.
+         * @param weight The edge weight; 0 removes an edge added earlier.
+         * @return A reference to this builder.
+         */
+        GraphBuilder &addEdge(size_t from, size_t to, int weight = 1);
+
+        /**
+         * @brief Adds the edge in both directions, as in an undirected graph.
+         *
+         * @param vertex1 The first endpoint.
+         * @param vertex2 The second endpoint.
+         * @param weight The edge weight.
+         * @return A reference to this builder.
+         */
+        GraphBuilder &addUndirectedEdge(size_t vertex1, size_t vertex2, int weight = 1);
+
+        /**
+         * @brief Builds the sparse graph, moving the collected edges into it.
+         *
+         * The builder is empty afterwards and can be reused for the same number of vertices.
+         *
+         * @return The graph, stored as Graph::Storage::Sparse.
+         */
+        Graph build();
+
+    private:
+        size_t vertices;
+        std::vector<Graph::WeightedEdge> edges;
+    };
+}
+
+#endif
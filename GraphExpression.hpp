@@ -0,0 +1,345 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef GRAPH_EXPRESSION_HPP
+#define GRAPH_EXPRESSION_HPP
+
+#include "Graph.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Base of the lazy element-wise expressions over graphs.
+     *
+     * lazy(g1) + g2 - 3 * lazy(g3) builds a small tree of expression objects instead of
+     * graphs. Assigning it to a Graph computes every cell of the result in one pass,
+     * without a temporary graph per operator. The expression only refers to its graphs,
+     * so it must be evaluated in the statement that builds it.
+     *
+     * Every node provides:
+     * - collect(leaves): appends the graphs of the expression
+     * - isKnownSymmetric(): true when the result is symmetric without a scan
+     * - loadRow(vertex, layout): prepares row vertex for at()
+     * - at(column, overflow): the cell of the prepared row; for the packed layout, column counts from the diagonal
+     *
+     * When every graph is sparse, rows are merged instead of expanded:
+     * - startRow(vertex): puts a cursor at the first edge of row vertex of every graph
+     * - nextColumn(): the smallest column not consumed yet by some cursor, or the order when none is left
+     * - take(column, overflow): the cell at column, advancing the cursors that stand on it; column must be nextColumn()
+     *
+     * Each operator node computes its cell in long long and narrows it under the overflow mode,
+     * like the eager operator would, and sets overflow when a cell left the int range.
+     * @tparam Derived The concrete expression type.
+     */
+    template <typename Derived>
+    class GraphExpression
+    {
+    public:
+        const Derived &self() const { return static_cast<const Derived &>(*this); }
+    };
+
+    /**
+     * @brief Leaf of an expression: reads a graph row in place or expands it into a full row.
+     */
+    class GraphTerm : public GraphExpression<GraphTerm>
+    {
+    public:
+        explicit GraphTerm(const Graph &graph) : graph(&graph), cells(nullptr), position(0), last(0) {}
+
+        void collect(std::vector<const Graph *> &leaves) const { leaves.push_back(graph); }
+        bool isKnownSymmetric() const { return graph->isKnownSymmetric(); }
+
+        void loadRow(size_t vertex, Graph::Storage layout) const
+        {
+            // Dense and packed rows are used in place when the result has the same layout
+            if (graph->storage == layout && layout != Graph::Storage::Sparse)
+            {
+                cells = graph->cellRun(vertex);
+                return;
+            }
+            scratch.assign(graph->vertices, 0);
+            for (const Graph::Edge &edge : graph->neighbors(vertex))
+            {
+                scratch[edge.vertex] = edge.weight;
+            }
+            cells = scratch.data();
+        }
+
+        int at(size_t column, bool &) const { return cells[column]; }
+
+        void startRow(size_t vertex) const
+        {
+            position = graph->rowOffsets[vertex];
+            last = graph->rowOffsets[vertex + 1];
+        }
+        size_t nextColumn() const { return position < last ? graph->columnIndices[position] : graph->vertices; }
+        int take(size_t column, bool &) const
+        {
+            return (position < last && graph->columnIndices[position] == column) ? graph->edgeWeights[position++] : 0;
+        }
+
+    private:
+        const Graph *graph;
+        mutable const int *cells;
+        mutable std::vector<int> scratch;
+        // Cursor into the CSR arrays of the current row
+        mutable size_t position;
+        mutable size_t last;
+    };
+
+    // Cell-wise operations of the binary expressions
+    struct AddCells
+    {
+        static long long apply(long long left, long long right) { return left + right; }
+    };
+
+    struct SubtractCells
+    {
+        static long long apply(long long left, long long right) { return left - right; }
+    };
+
+    /**
+     * @brief Element-wise combination of two expressions of the same size.
+     */
+    template <typename Left, typename Right, typename Operation>
+    class GraphBinaryExpression : public GraphExpression<GraphBinaryExpression<Left, Right, Operation>>
+    {
+    public:
+        GraphBinaryExpression(const Left &left, const Right &right) : left(left), right(right) {}
+
+        void collect(std::vector<const Graph *> &leaves) const
+        {
+            left.collect(leaves);
+            right.collect(leaves);
+        }
+        bool isKnownSymmetric() const { return left.isKnownSymmetric() && right.isKnownSymmetric(); }
+
+        void loadRow(size_t vertex, Graph::Storage layout) const
+        {
+            left.loadRow(vertex, layout);
+            right.loadRow(vertex, layout);
+        }
+
+        int at(size_t column, bool &overflow) const
+        {
+            return Graph::narrow(Operation::apply(left.at(column, overflow), right.at(column, overflow)), overflow);
+        }
+
+        void startRow(size_t vertex) const
+        {
+            left.startRow(vertex);
+            right.startRow(vertex);
+        }
+        size_t nextColumn() const { return std::min(left.nextColumn(), right.nextColumn()); }
+        int take(size_t column, bool &overflow) const
+        {
+            return Graph::narrow(Operation::apply(left.take(column, overflow), right.take(column, overflow)), overflow);
+        }
+
+    private:
+        Left left;
+        Right right;
+    };
+
+    /**
+     * @brief An expression multiplied by a scalar; negation is a scale by -1.
+     */
+    template <typename Operand>
+    class GraphScaledExpression : public GraphExpression<GraphScaledExpression<Operand>>
+    {
+    public:
+        GraphScaledExpression(const Operand &operand, int scalar) : operand(operand), scalar(scalar) {}
+
+        void collect(std::vector<const Graph *> &leaves) const { operand.collect(leaves); }
+        bool isKnownSymmetric() const { return operand.isKnownSymmetric(); }
+        void loadRow(size_t vertex, Graph::Storage layout) const { operand.loadRow(vertex, layout); }
+        int at(size_t column, bool &overflow) const { return Graph::narrow(static_cast<long long>(scalar) * operand.at(column, overflow), overflow); }
+        void startRow(size_t vertex) const { operand.startRow(vertex); }
+        size_t nextColumn() const { return operand.nextColumn(); }
+        int take(size_t column, bool &overflow) const { return Graph::narrow(static_cast<long long>(scalar) * operand.take(column, overflow), overflow); }
+
+    private:
+        Operand operand;
+        int scalar;
+    };
+
+    /**
+     * @brief Starts a lazy expression from a graph.
+     *
+     * @param graph The graph; it must outlive the evaluation of the expression.
+     * @return The leaf expression.
+     */
+    inline GraphTerm lazy(const Graph &graph)
+    {
+        return GraphTerm(graph);
+    }
+
+    template <typename Left, typename Right>
+    GraphBinaryExpression<Left, Right, AddCells> operator+(const GraphExpression<Left> &left, const GraphExpression<Right> &right)
+    {
+        return GraphBinaryExpression<Left, Right, AddCells>(left.self(), right.self());
+    }
+
+    template <typename Left>
+    GraphBinaryExpression<Left, GraphTerm, AddCells> operator+(const GraphExpression<Left> &left, const Graph &right)
+    {
+        return GraphBinaryExpression<Left, GraphTerm, AddCells>(left.self(), GraphTerm(right));
+    }
+
+    template <typename Right>
+    GraphBinaryExpression<GraphTerm, Right, AddCells> operator+(const Graph &left, const GraphExpression<Right> &right)
+    {
+        return GraphBinaryExpression<GraphTerm, Right, AddCells>(GraphTerm(left), right.self());
+    }
+
+    template <typename Left, typename Right>
+    GraphBinaryExpression<Left, Right, SubtractCells> operator-(const GraphExpression<Left> &left, const GraphExpression<Right> &right)
+    {
+        return GraphBinaryExpression<Left, Right, SubtractCells>(left.self(), right.self());
+    }
+
+    template <typename Left>
+    GraphBinaryExpression<Left, GraphTerm, SubtractCells> operator-(const GraphExpression<Left> &left, const Graph &right)
+    {
+        return GraphBinaryExpression<Left, GraphTerm, SubtractCells>(left.self(), GraphTerm(right));
+    }
+
+    template <typename Right>
+    GraphBinaryExpression<GraphTerm, Right, SubtractCells> operator-(const Graph &left, const GraphExpression<Right> &right)
+    {
+        return GraphBinaryExpression<GraphTerm, Right, SubtractCells>(GraphTerm(left), right.self());
+    }
+
+    template <typename Operand>
+    GraphScaledExpression<Operand> operator*(int scalar, const GraphExpression<Operand> &operand)
+    {
+        return GraphScaledExpression<Operand>(operand.self(), scalar);
+    }
+
+    template <typename Operand>
+    GraphScaledExpression<Operand> operator*(const GraphExpression<Operand> &operand, int scalar)
+    {
+        return GraphScaledExpression<Operand>(operand.self(), scalar);
+    }
+
+    template <typename Operand>
+    GraphScaledExpression<Operand> operator-(const GraphExpression<Operand> &operand)
+    {
+        return GraphScaledExpression<Operand>(operand.self(), -1);
+    }
+
+    template <typename Derived>
+    Graph::Graph(const GraphExpression<Derived> &expression) : Graph()
+    {
+        evaluate(expression.self());
+    }
+
+    template <typename Derived>
+    Graph &Graph::operator=(const GraphExpression<Derived> &expression)
+    {
+        // The result is built in a new buffer, so the expression may read this graph
+        evaluate(expression.self());
+        return *this;
+    }
+
+    template <typename Expression>
+    void Graph::evaluate(const Expression &expression)
+    {
+        std::vector<const Graph *> leaves;
+        expression.collect(leaves);
+        const size_t order = leaves.front()->vertices;
+        // Graphs that all share the dense or packed layout are read in place, anything else is expanded row by row
+        Storage layout = leaves.front()->storage;
+        for (const Graph *leaf : leaves)
+        {
+            if (leaf->vertices != order)
+            {
+                throw std::invalid_argument("Graphs must be of the same size to combine.");
+            }
+            if (leaf->storage != layout)
+            {
+                layout = Storage::Dense;
+            }
+        }
+
+        Graph result;
+        CellStats cells;
+        bool overflow = false;
+        if (layout == Storage::Sparse)
+        {
+            // Merges the sorted rows of the leaves, one cursor per leaf, so each row costs its edges
+            // times the number of leaves instead of V; the result goes straight into CSR arrays
+            result.resize(0);
+            result.vertices = order;
+            result.storage = Storage::Sparse;
+            result.rowOffsets.assign(order + 1, 0);
+            size_t edges = 0;
+            for (const Graph *leaf : leaves)
+            {
+                edges += leaf->columnIndices.size();
+            }
+            result.columnIndices.reserve(edges);
+            result.edgeWeights.reserve(edges);
+            for (size_t i = 0; i < order; i++)
+            {
+                expression.startRow(i);
+                for (size_t j = expression.nextColumn(); j < order; j = expression.nextColumn())
+                {
+                    // Cells that cancel out are dropped
+                    const int weight = expression.take(j, overflow);
+                    if (weight != 0)
+                    {
+                        result.columnIndices.push_back(j);
+                        result.edgeWeights.push_back(weight);
+                        cells.add(weight);
+                        if (j == i)
+                        {
+                            cells.selfLoops++;
+                        }
+                    }
+                }
+                result.rowOffsets[i + 1] = result.columnIndices.size();
+            }
+        }
+        else
+        {
+            if (layout == Storage::Symmetric)
+            {
+                result.resizePacked(order);
+            }
+            else
+            {
+                result.resize(order);
+            }
+            for (size_t i = 0; i < order; i++)
+            {
+                expression.loadRow(i, layout);
+                int *out = result.cellRun(i);
+                const size_t length = result.cellRunLength(i);
+                for (size_t j = 0; j < length; j++)
+                {
+                    out[j] = expression.at(j, overflow);
+                }
+                result.addRunStats(cells, i, out);
+            }
+        }
+        result.setStats(cells);
+        result.overflowed = overflow;
+        for (const Graph *leaf : leaves)
+        {
+            result.overflowed = result.overflowed || leaf->overflowed;
+        }
+        if (expression.isKnownSymmetric())
+        {
+            result.setSymmetry(true);
+        }
+        *this = std::move(result);
+    }
+}
+
+#endif
@@ -0,0 +1,144 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#include "GraphSorter.hpp"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+using namespace std;
+
+namespace ariel
+{
+    GraphSorter::GraphSorter(const vector<Graph> &graphs) : graphs(graphs), keys(graphs.size()), tests(0)
+    {
+        for (size_t i = 0; i < graphs.size(); i++)
+        {
+            this->keys[i].edges = graphs[i].countEdges();
+            this->keys[i].vertices = graphs[i].vertices;
+            this->keys[i].cells = graphs[i].cellStats().nonZero;
+        }
+    }
+
+    bool GraphSorter::mayFit(size_t i, size_t j) const
+    {
+        return this->keys[i].vertices <= this->keys[j].vertices && this->keys[i].cells <= this->keys[j].cells;
+    }
+
+    bool GraphSorter::isSubgraph(size_t i, size_t j)
+    {
+        const size_t index = i * this->graphs.size() + j;
+        unordered_map<size_t, bool>::const_iterator known = this->subgraphs.find(index);
+        if (known != this->subgraphs.end())
+        {
+            return known->second;
+        }
+        this->tests++;
+        const bool result = this->graphs[i].isSubgraph(this->graphs[j]);
+        this->subgraphs[index] = result;
+        return result;
+    }
+
+    int GraphSorter::compare(size_t i, size_t j)
+    {
+        const Key &left = this->keys[i];
+        const Key &right = this->keys[j];
+        // The order Graph::compare falls back to when the subgraph tests do not decide
+        int byCounts = 0;
+        if (left.edges != right.edges)
+        {
+            byCounts = left.edges < right.edges ? -1 : 1;
+        }
+        else if (left.vertices != right.vertices)
+        {
+            byCounts = left.vertices < right.vertices ? -1 : 1;
+        }
+        const bool inRight = mayFit(i, j);
+        const bool containsRight = mayFit(j, i);
+        // With as many vertices and cells, either graph fits in the other exactly when they are
+        // isomorphic, so the two tests agree and the counts decide
+        if (inRight == containsRight)
+        {
+            return byCounts;
+        }
+        // Only one direction is possible; it matters only when the counts order the pair the other way
+        if (inRight)
+        {
+            return (byCounts < 0 || isSubgraph(i, j)) ? -1 : byCounts;
+        }
+        return (byCounts > 0 || isSubgraph(j, i)) ? 1 : byCounts;
+    }
+
+    vector<size_t> GraphSorter::order()
+    {
+        // Bottom-up merge sort: it only moves positions between two buffers, so a comparator
+        // that is not transitive can spoil the order but never the bounds
+        const size_t count = this->graphs.size();
+        vector<size_t> positions(count);
+        iota(positions.begin(), positions.end(), 0);
+        vector<size_t> merged(count);
+        for (size_t width = 1; width < count; width *= 2)
+        {
+            for (size_t low = 0; low < count; low += 2 * width)
+            {
+                const size_t middle = min(low + width, count);
+                const size_t high = min(low + 2 * width, count);
+                size_t left = low;
+                size_t right = middle;
+                for (size_t out = low; out < high; out++)
+                {
+                    // The right run goes first only when strictly smaller, so equal graphs keep their order
+                    if (right < high && (left == middle || compare(positions[right], positions[left]) < 0))
+                    {
+                        merged[out] = positions[right++];
+                    }
+                    else
+                    {
+                        merged[out] = positions[left++];
+                    }
+                }
+            }
+            positions.swap(merged);
+        }
+        return positions;
+    }
+
+    vector<size_t> GraphSorter::uniqueOrder()
+    {
+        vector<size_t> positions = order();
+        positions.erase(unique(positions.begin(), positions.end(), [this](size_t i, size_t j)
+                               { return compare(i, j) == 0; }),
+                        positions.end());
+        return positions;
+    }
+
+    size_t GraphSorter::getSubgraphTests() const
+    {
+        return this->tests;
+    }
+
+    void GraphSorter::rearrange(vector<Graph> &graphs, const vector<size_t> &order)
+    {
+        // Moving a graph only hands over its shared buffers, so nothing is copied
+        vector<Graph> arranged;
+        arranged.reserve(order.size());
+        for (size_t position : order)
+        {
+            arranged.push_back(std::move(graphs[position]));
+        }
+        graphs.swap(arranged);
+    }
+
+    void GraphSorter::sort(vector<Graph> &graphs)
+    {
+        const vector<size_t> positions = GraphSorter(graphs).order();
+        rearrange(graphs, positions);
+    }
+
+    void GraphSorter::sortUnique(vector<Graph> &graphs)
+    {
+        const vector<size_t> positions = GraphSorter(graphs).uniqueOrder();
+        rearrange(graphs, positions);
+    }
+}
@@ -0,0 +1,83 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef GRAPH_SORTER_HPP
+#define GRAPH_SORTER_HPP
+
+#include "Graph.hpp"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Orders a whole collection of graphs the way Graph::operator< orders two of them.
+     *
+     * The edge count, vertex count and number of non-zero cells of every graph are computed
+     * once. Most pairs are then ordered from these keys alone: a subgraph test can only change
+     * the order of two graphs when one could fit inside the other and the counts put it after
+     * the other. The subgraph tests that are still needed are remembered, so no pair is searched
+     * twice, and they use the fingerprints cached on the graphs.
+     *
+     * operator< is not always transitive: the subgraph test and the edge counts can disagree,
+     * e.g. A < B < C by counts while C is a subgraph of A. The result is ascending only when
+     * operator< is transitive on the collection; otherwise every graph still appears exactly
+     * once, in an order that is not guaranteed. The sort is a merge sort of its own rather than
+     * std::stable_sort, which needs a strict weak ordering.
+     */
+    class GraphSorter
+    {
+    public:
+        /**
+         * @brief Prepares the keys of every graph.
+         *
+         * @param graphs The collection; it must outlive the sorter and not change while it is used.
+         */
+        explicit GraphSorter(const std::vector<Graph> &graphs);
+
+        /**
+         * @brief Orders graph i against graph j.
+         *
+         * @return Negative when graph i is smaller, positive when it is larger and 0 when the
+         *         graphs are equal, matching Graph::operator< and Graph::operator==.
+         */
+        int compare(size_t i, size_t j);
+
+        // Positions of the graphs in ascending order (see above); equal graphs keep their relative order
+        std::vector<size_t> order();
+        // Ascending order keeping only the first of every run of equal graphs
+        std::vector<size_t> uniqueOrder();
+
+        // Number of subgraph searches run so far
+        size_t getSubgraphTests() const;
+
+        // Sorts graphs in place
+        static void sort(std::vector<Graph> &graphs);
+        // Sorts graphs in place and removes every graph equal to the one before it
+        static void sortUnique(std::vector<Graph> &graphs);
+
+    private:
+        struct Key
+        {
+            size_t edges;
+            size_t vertices;
+            size_t cells;
+        };
+
+        const std::vector<Graph> &graphs;
+        std::vector<Key> keys;
+        // Index i * size + j -> whether graph i is a subgraph of graph j
+        std::unordered_map<size_t, bool> subgraphs;
+        size_t tests;
+
+        // Whether the counts allow graph i to be a subgraph of graph j
+        bool mayFit(size_t i, size_t j) const;
+        bool isSubgraph(size_t i, size_t j);
+        // Moves the graphs at positions order into graphs, in that order
+        static void rearrange(std::vector<Graph> &graphs, const std::vector<size_t> &order);
+    };
+}
+
+#endif
@@ -0,0 +1,747 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#include "MatrixKernels.hpp"
+#include "AlignedAllocator.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace ariel
+{
+    // The element-wise kernels are written once on 64-byte blocks of 16 cells using GCC/Clang vector
+    // extensions. They are always inlined into small wrappers built for each instruction set, so the
+    // same block is one zmm operation in the AVX-512 build, two ymm operations in the AVX2 build and
+    // four xmm operations in the SSE2 build.
+    typedef int CellBlock __attribute__((vector_size(64)));
+    typedef long long WideCellBlock __attribute__((vector_size(128)));
+    // Same lanes as CellBlock for arithmetic that must wrap without signed overflow
+    typedef unsigned int UnsignedCellBlock __attribute__((vector_size(64)));
+    static const size_t BlockCells = sizeof(CellBlock) / sizeof(int);
+
+    // Narrows an exact value to an int: clamped when saturate is set, wrapped otherwise
+    template <typename Sum>
+    static inline int narrowCell(Sum value, bool saturate, bool &overflow)
+    {
+        if (value > INT_MAX || value < INT_MIN)
+        {
+            overflow = true;
+            if (saturate)
+            {
+                return value > 0 ? INT_MAX : INT_MIN;
+            }
+            return static_cast<int>(static_cast<unsigned int>(value));
+        }
+        return static_cast<int>(value);
+    }
+
+    // Sums and differences wrap in unsigned lanes, so Strassen's intermediate blocks may leave the int range
+    static inline __attribute__((always_inline)) void addCells(const int *left, const int *right, int *out, size_t length)
+    {
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            UnsignedCellBlock a, b;
+            memcpy(&a, left + j, sizeof a);
+            memcpy(&b, right + j, sizeof b);
+            a += b;
+            memcpy(out + j, &a, sizeof a);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = static_cast<int>(static_cast<unsigned int>(left[j]) + static_cast<unsigned int>(right[j]));
+        }
+    }
+
+    static inline __attribute__((always_inline)) void subtractCells(const int *left, const int *right, int *out, size_t length)
+    {
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            UnsignedCellBlock a, b;
+            memcpy(&a, left + j, sizeof a);
+            memcpy(&b, right + j, sizeof b);
+            a -= b;
+            memcpy(out + j, &a, sizeof a);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = static_cast<int>(static_cast<unsigned int>(left[j]) - static_cast<unsigned int>(right[j]));
+        }
+    }
+
+    static inline __attribute__((always_inline)) void negateCells(const int *cells, int *out, size_t length)
+    {
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a;
+            memcpy(&a, cells + j, sizeof a);
+            a = -a;
+            memcpy(out + j, &a, sizeof a);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = -cells[j];
+        }
+    }
+
+    static inline __attribute__((always_inline)) void addScalarCells(const int *cells, int *out, size_t length, int value)
+    {
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a;
+            memcpy(&a, cells + j, sizeof a);
+            a += value;
+            memcpy(out + j, &a, sizeof a);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = cells[j] + value;
+        }
+    }
+
+    static inline __attribute__((always_inline)) void multiplyScalarCells(const int *cells, int *out, size_t length, int scalar)
+    {
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a;
+            memcpy(&a, cells + j, sizeof a);
+            a *= scalar;
+            memcpy(out + j, &a, sizeof a);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = cells[j] * scalar;
+        }
+    }
+
+    // One quotient with the prepared magic number, for the cells after the last whole block
+    static inline int divideCell(int cell, const MatrixKernels::Reciprocal &divisor)
+    {
+        const long long wide = static_cast<long long>(cell);
+        // The sum is exact in 64 bits; like the vector lanes, only its low 32 bits are kept
+        int high = static_cast<int>(static_cast<unsigned int>(((wide * divisor.multiplier) >> 32) + wide * divisor.correction));
+        high >>= divisor.shift;
+        return high - (high >> 31);
+    }
+
+    static inline __attribute__((always_inline)) void divideScalarCells(const int *cells, int *out, size_t length, const MatrixKernels::Reciprocal &divisor)
+    {
+        // Division by 1 and -1 has no magic number; it is a copy or a negation
+        if (divisor.divisor == 1)
+        {
+            memmove(out, cells, length * sizeof(int));
+            return;
+        }
+        if (divisor.divisor == -1)
+        {
+            negateCells(cells, out, length);
+            return;
+        }
+        // The correction is applied with masks so the loop has no per-cell branch
+        const int addMask = divisor.correction > 0 ? -1 : 0;
+        const int subtractMask = divisor.correction < 0 ? -1 : 0;
+        const long long multiplier = divisor.multiplier;
+        const int shift = divisor.shift;
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a;
+            memcpy(&a, cells + j, sizeof a);
+            // Sign-extended 32 x 32 -> 64-bit products, so the compiler emits pmuldq / vpmuldq
+            const WideCellBlock product = __builtin_convertvector(a, WideCellBlock) * multiplier;
+            CellBlock high = __builtin_convertvector(product >> 32, CellBlock);
+            // The terms of the correction may leave the int range on their own, so they wrap in unsigned lanes
+            UnsignedCellBlock corrected = reinterpret_cast<UnsignedCellBlock>(high);
+            corrected += reinterpret_cast<UnsignedCellBlock>(a & addMask);
+            corrected -= reinterpret_cast<UnsignedCellBlock>(a & subtractMask);
+            high = reinterpret_cast<CellBlock>(corrected);
+            high >>= shift;
+            // Rounds negative quotients toward zero
+            high -= high >> 31;
+            memcpy(out + j, &high, sizeof high);
+        }
+        for (; j < length; j++)
+        {
+            out[j] = divideCell(cells[j], divisor);
+        }
+    }
+
+    static inline __attribute__((always_inline)) bool minPlusCells(const int *cells, int *out, size_t length, int weight)
+    {
+        const int unreachable = MatrixKernels::Unreachable;
+        // Only one direction can overflow for a given weight; out-of-range sums are clamped to that end
+        const bool heavier = weight >= 0;
+        const int clamp = heavier ? unreachable - 1 : INT_MIN;
+        CellBlock clamped = CellBlock{};
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a, b;
+            memcpy(&a, cells + j, sizeof a);
+            memcpy(&b, out + j, sizeof b);
+            // Lanes of cells without a walk keep their old value
+            const CellBlock missing = (a == unreachable);
+            // The add wraps in unsigned lanes; a wrapped sum moved against the sign of the weight
+            const CellBlock sum = reinterpret_cast<CellBlock>(reinterpret_cast<UnsignedCellBlock>(a) + static_cast<unsigned int>(weight));
+            const CellBlock outside = (heavier ? ((sum < a) | (sum == unreachable)) : (sum > a)) & ~missing;
+            const CellBlock exact = (clamp & outside) | (sum & ~outside);
+            const CellBlock lighter = (exact < b) & ~missing;
+            b = (exact & lighter) | (b & ~lighter);
+            clamped |= outside;
+            memcpy(out + j, &b, sizeof b);
+        }
+        bool overflow = false;
+        for (size_t lane = 0; lane < BlockCells; lane++)
+        {
+            overflow = overflow || clamped[lane] != 0;
+        }
+        for (; j < length; j++)
+        {
+            if (cells[j] != unreachable)
+            {
+                const long long sum = static_cast<long long>(cells[j]) + weight;
+                const bool outside = sum >= unreachable || sum < INT_MIN;
+                overflow = overflow || outside;
+                out[j] = min(out[j], outside ? clamp : static_cast<int>(sum));
+            }
+        }
+        return overflow;
+    }
+
+    static inline __attribute__((always_inline)) bool combineWideCells(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate)
+    {
+        const WideCellBlock high = WideCellBlock{} + INT_MAX;
+        const WideCellBlock low = WideCellBlock{} + INT_MIN;
+        WideCellBlock outside = WideCellBlock{};
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a, b = CellBlock{};
+            memcpy(&a, x + j, sizeof a);
+            if (y != nullptr)
+            {
+                memcpy(&b, y + j, sizeof b);
+            }
+            // Each term is below 2^62 in magnitude, so the 64-bit sum is exact
+            WideCellBlock sum = __builtin_convertvector(a, WideCellBlock) * xFactor + __builtin_convertvector(b, WideCellBlock) * yFactor + offset;
+            const WideCellBlock above = (sum > high);
+            const WideCellBlock below = (sum < low);
+            outside |= above | below;
+            if (saturate)
+            {
+                sum = (high & above) | (low & below) | (sum & ~(above | below));
+            }
+            // Converting drops the upper half of each lane, which wraps the value
+            a = __builtin_convertvector(sum, CellBlock);
+            memcpy(out + j, &a, sizeof a);
+        }
+        bool overflow = false;
+        for (size_t lane = 0; lane < BlockCells; lane++)
+        {
+            overflow = overflow || outside[lane] != 0;
+        }
+        for (; j < length; j++)
+        {
+            const long long sum = static_cast<long long>(x[j]) * xFactor + (y != nullptr ? static_cast<long long>(y[j]) * yFactor : 0) + offset;
+            out[j] = narrowCell(sum, saturate, overflow);
+        }
+        return overflow;
+    }
+
+    static inline __attribute__((always_inline)) MatrixKernels::RunSummary summarizeCells(const int *cells, size_t length)
+    {
+        // Zero cells are replaced by INT_MAX for the minimum and INT_MIN for the maximum
+        CellBlock count = CellBlock{};
+        CellBlock smallest = CellBlock{} + INT_MAX;
+        CellBlock largest = CellBlock{} + INT_MIN;
+        size_t j = 0;
+        for (; j + BlockCells <= length; j += BlockCells)
+        {
+            CellBlock a;
+            memcpy(&a, cells + j, sizeof a);
+            const CellBlock edge = (a != 0);
+            count -= edge;
+            const CellBlock low = (a & edge) | (INT_MAX & ~edge);
+            const CellBlock high = (a & edge) | (INT_MIN & ~edge);
+            const CellBlock lower = (low < smallest);
+            const CellBlock higher = (high > largest);
+            smallest = (low & lower) | (smallest & ~lower);
+            largest = (high & higher) | (largest & ~higher);
+        }
+        MatrixKernels::RunSummary summary = {0, INT_MAX, INT_MIN};
+        for (size_t lane = 0; lane < BlockCells; lane++)
+        {
+            summary.nonZero += static_cast<size_t>(count[lane]);
+            summary.minWeight = min(summary.minWeight, smallest[lane]);
+            summary.maxWeight = max(summary.maxWeight, largest[lane]);
+        }
+        for (; j < length; j++)
+        {
+            if (cells[j] != 0)
+            {
+                summary.nonZero++;
+                summary.minWeight = min(summary.minWeight, cells[j]);
+                summary.maxWeight = max(summary.maxWeight, cells[j]);
+            }
+        }
+        return summary;
+    }
+
+    // One struct per instruction set; the bodies above are inlined and compiled for that target
+    struct Sse2Kernels
+    {
+        static void add(const int *left, const int *right, int *out, size_t length) { addCells(left, right, out, length); }
+        static void subtract(const int *left, const int *right, int *out, size_t length) { subtractCells(left, right, out, length); }
+        static void negate(const int *cells, int *out, size_t length) { negateCells(cells, out, length); }
+        static void addScalar(const int *cells, int *out, size_t length, int value) { addScalarCells(cells, out, length, value); }
+        static void multiplyScalar(const int *cells, int *out, size_t length, int scalar) { multiplyScalarCells(cells, out, length, scalar); }
+        static void divideScalar(const int *cells, int *out, size_t length, const MatrixKernels::Reciprocal &divisor) { divideScalarCells(cells, out, length, divisor); }
+        static bool minPlus(const int *cells, int *out, size_t length, int weight) { return minPlusCells(cells, out, length, weight); }
+        static bool combineWide(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate)
+        {
+            return combineWideCells(x, y, out, length, xFactor, yFactor, offset, saturate);
+        }
+        static MatrixKernels::RunSummary summarize(const int *cells, size_t length) { return summarizeCells(cells, length); }
+    };
+
+#if defined(__x86_64__) || defined(__i386__)
+    struct Avx2Kernels
+    {
+        __attribute__((target("avx2"))) static void add(const int *left, const int *right, int *out, size_t length) { addCells(left, right, out, length); }
+        __attribute__((target("avx2"))) static void subtract(const int *left, const int *right, int *out, size_t length) { subtractCells(left, right, out, length); }
+        __attribute__((target("avx2"))) static void negate(const int *cells, int *out, size_t length) { negateCells(cells, out, length); }
+        __attribute__((target("avx2"))) static void addScalar(const int *cells, int *out, size_t length, int value) { addScalarCells(cells, out, length, value); }
+        __attribute__((target("avx2"))) static void multiplyScalar(const int *cells, int *out, size_t length, int scalar) { multiplyScalarCells(cells, out, length, scalar); }
+        __attribute__((target("avx2"))) static void divideScalar(const int *cells, int *out, size_t length, const MatrixKernels::Reciprocal &divisor) { divideScalarCells(cells, out, length, divisor); }
+        __attribute__((target("avx2"))) static bool minPlus(const int *cells, int *out, size_t length, int weight) { return minPlusCells(cells, out, length, weight); }
+        __attribute__((target("avx2"))) static bool combineWide(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate)
+        {
+            return combineWideCells(x, y, out, length, xFactor, yFactor, offset, saturate);
+        }
+        __attribute__((target("avx2"))) static MatrixKernels::RunSummary summarize(const int *cells, size_t length) { return summarizeCells(cells, length); }
+    };
+
+    struct Avx512Kernels
+    {
+        __attribute__((target("avx512f"))) static void add(const int *left, const int *right, int *out, size_t length) { addCells(left, right, out, length); }
+        __attribute__((target("avx512f"))) static void subtract(const int *left, const int *right, int *out, size_t length) { subtractCells(left, right, out, length); }
+        __attribute__((target("avx512f"))) static void negate(const int *cells, int *out, size_t length) { negateCells(cells, out, length); }
+        __attribute__((target("avx512f"))) static void addScalar(const int *cells, int *out, size_t length, int value) { addScalarCells(cells, out, length, value); }
+        __attribute__((target("avx512f"))) static void multiplyScalar(const int *cells, int *out, size_t length, int scalar) { multiplyScalarCells(cells, out, length, scalar); }
+        __attribute__((target("avx512f"))) static void divideScalar(const int *cells, int *out, size_t length, const MatrixKernels::Reciprocal &divisor) { divideScalarCells(cells, out, length, divisor); }
+        __attribute__((target("avx512f"))) static bool minPlus(const int *cells, int *out, size_t length, int weight) { return minPlusCells(cells, out, length, weight); }
+        __attribute__((target("avx512f"))) static bool combineWide(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate)
+        {
+            return combineWideCells(x, y, out, length, xFactor, yFactor, offset, saturate);
+        }
+        __attribute__((target("avx512f"))) static MatrixKernels::RunSummary summarize(const int *cells, size_t length) { return summarizeCells(cells, length); }
+    };
+#endif
+
+    const MatrixKernels::ElementwiseTable &MatrixKernels::elementwise()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static const ElementwiseTable sse2 = {"sse2", Sse2Kernels::add, Sse2Kernels::subtract, Sse2Kernels::negate, Sse2Kernels::addScalar,
+                                              Sse2Kernels::multiplyScalar, Sse2Kernels::divideScalar, Sse2Kernels::minPlus, Sse2Kernels::combineWide, Sse2Kernels::summarize};
+        static const ElementwiseTable avx2 = {"avx2", Avx2Kernels::add, Avx2Kernels::subtract, Avx2Kernels::negate, Avx2Kernels::addScalar,
+                                              Avx2Kernels::multiplyScalar, Avx2Kernels::divideScalar, Avx2Kernels::minPlus, Avx2Kernels::combineWide, Avx2Kernels::summarize};
+        static const ElementwiseTable avx512 = {"avx512", Avx512Kernels::add, Avx512Kernels::subtract, Avx512Kernels::negate, Avx512Kernels::addScalar,
+                                                Avx512Kernels::multiplyScalar, Avx512Kernels::divideScalar, Avx512Kernels::minPlus, Avx512Kernels::combineWide, Avx512Kernels::summarize};
+        // The CPU is queried once; every later call returns the same build
+        static const ElementwiseTable &chosen = __builtin_cpu_supports("avx512f") ? avx512 : (__builtin_cpu_supports("avx2") ? avx2 : sse2);
+        return chosen;
+#else
+        static const ElementwiseTable generic = {"generic", Sse2Kernels::add, Sse2Kernels::subtract, Sse2Kernels::negate, Sse2Kernels::addScalar,
+                                                 Sse2Kernels::multiplyScalar, Sse2Kernels::divideScalar, Sse2Kernels::minPlus, Sse2Kernels::combineWide, Sse2Kernels::summarize};
+        return generic;
+#endif
+    }
+
+    void MatrixKernels::add(const int *left, const int *right, int *out, size_t length)
+    {
+        elementwise().add(left, right, out, length);
+    }
+
+    void MatrixKernels::subtract(const int *left, const int *right, int *out, size_t length)
+    {
+        elementwise().subtract(left, right, out, length);
+    }
+
+    void MatrixKernels::negate(const int *cells, int *out, size_t length)
+    {
+        elementwise().negate(cells, out, length);
+    }
+
+    void MatrixKernels::addScalar(const int *cells, int *out, size_t length, int value)
+    {
+        elementwise().addScalar(cells, out, length, value);
+    }
+
+    void MatrixKernels::multiplyScalar(const int *cells, int *out, size_t length, int scalar)
+    {
+        elementwise().multiplyScalar(cells, out, length, scalar);
+    }
+
+    MatrixKernels::Reciprocal::Reciprocal(int divisor) : divisor(divisor), multiplier(0), correction(0), shift(0)
+    {
+        if (divisor == 0)
+        {
+            throw invalid_argument("Division by zero is not allowed.");
+        }
+        if (divisor == 1 || divisor == -1)
+        {
+            return;
+        }
+        // Smallest p >= 32 with 2^p > nc * (|d| - 2^p mod |d|), where nc is the largest dividend
+        // whose remainder is |d| - 1; the magic number is then ceil(2^p / |d|) (Hacker's Delight, 10-1)
+        const unsigned int two31 = 0x80000000u;
+        const unsigned int magnitude = divisor < 0 ? 0u - static_cast<unsigned int>(divisor) : static_cast<unsigned int>(divisor);
+        const unsigned int limit = two31 + (static_cast<unsigned int>(divisor) >> 31);
+        const unsigned int nc = limit - 1 - limit % magnitude;
+        int p = 31;
+        unsigned int q1 = two31 / nc;
+        unsigned int r1 = two31 - q1 * nc;
+        unsigned int q2 = two31 / magnitude;
+        unsigned int r2 = two31 - q2 * magnitude;
+        unsigned int delta;
+        do
+        {
+            p++;
+            q1 *= 2;
+            r1 *= 2;
+            if (r1 >= nc)
+            {
+                q1++;
+                r1 -= nc;
+            }
+            q2 *= 2;
+            r2 *= 2;
+            if (r2 >= magnitude)
+            {
+                q2++;
+                r2 -= magnitude;
+            }
+            delta = magnitude - r2;
+        } while (q1 < delta || (q1 == delta && r1 == 0));
+        // The magic number is reinterpreted as a signed int; when its sign is wrong for the divisor
+        // the dividend is added back (or subtracted) after the multiply-high
+        const unsigned int magic = divisor < 0 ? 0u - (q2 + 1) : q2 + 1;
+        this->multiplier = static_cast<int>(magic);
+        if (divisor > 0 && this->multiplier < 0)
+        {
+            this->correction = 1;
+        }
+        else if (divisor < 0 && this->multiplier > 0)
+        {
+            this->correction = -1;
+        }
+        this->shift = p - 32;
+    }
+
+    void MatrixKernels::divideScalar(const int *cells, int *out, size_t length, const Reciprocal &divisor)
+    {
+        elementwise().divideScalar(cells, out, length, divisor);
+    }
+
+    void MatrixKernels::divideScalar(const int *cells, int *out, size_t length, int scalar)
+    {
+        divideScalar(cells, out, length, Reciprocal(scalar));
+    }
+
+    bool MatrixKernels::minPlus(const int *cells, int *out, size_t length, int weight)
+    {
+        return elementwise().minPlus(cells, out, length, weight);
+    }
+
+    bool MatrixKernels::combineWide(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate)
+    {
+        return elementwise().combineWide(x, y, out, length, xFactor, yFactor, offset, saturate);
+    }
+
+    MatrixKernels::RunSummary MatrixKernels::summarize(const int *cells, size_t length)
+    {
+        return elementwise().summarize(cells, length);
+    }
+
+    const char *MatrixKernels::getInstructionSet()
+    {
+        return elementwise().name;
+    }
+
+    const int MatrixKernels::Unreachable;
+    const size_t MatrixKernels::TileRows;
+    const size_t MatrixKernels::TileDepth;
+    const size_t MatrixKernels::TileColumns;
+
+    void MatrixKernels::multiply(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd)
+    {
+        multiplyBlocks(left, stride, right, stride, out, stride, n, rowBegin, rowEnd);
+    }
+
+    // Products and sums are taken in unsigned int, which wraps by definition; the low 32 bits of
+    // every cell are those of the exact sum, whatever the intermediate values were
+    void MatrixKernels::multiplyBlocks(const int *left, size_t leftStride, const int *right, size_t rightStride, int *out, size_t outStride,
+                                       size_t n, size_t rowBegin, size_t rowEnd)
+    {
+        for (size_t ii = rowBegin; ii < rowEnd; ii += TileRows)
+        {
+            const size_t iEnd = min(ii + TileRows, rowEnd);
+            for (size_t kk = 0; kk < n; kk += TileDepth)
+            {
+                const size_t kEnd = min(kk + TileDepth, n);
+                for (size_t jj = 0; jj < n; jj += TileColumns)
+                {
+                    const size_t width = min(jj + TileColumns, n) - jj;
+                    size_t i = ii;
+                    // Four rows at a time: every cell of right feeds four accumulators
+                    for (; i + 4 <= iEnd; i += 4)
+                    {
+                        int *out0 = out + i * outStride + jj;
+                        int *out1 = out0 + outStride;
+                        int *out2 = out1 + outStride;
+                        int *out3 = out2 + outStride;
+                        for (size_t k = kk; k < kEnd; k++)
+                        {
+                            const unsigned int a0 = static_cast<unsigned int>(left[i * leftStride + k]);
+                            const unsigned int a1 = static_cast<unsigned int>(left[(i + 1) * leftStride + k]);
+                            const unsigned int a2 = static_cast<unsigned int>(left[(i + 2) * leftStride + k]);
+                            const unsigned int a3 = static_cast<unsigned int>(left[(i + 3) * leftStride + k]);
+                            // Missing edges contribute nothing, which is common in adjacency matrices
+                            if ((a0 | a1 | a2 | a3) == 0)
+                            {
+                                continue;
+                            }
+                            const int *rightRow = right + k * rightStride + jj;
+                            for (size_t j = 0; j < width; j++)
+                            {
+                                const unsigned int b = static_cast<unsigned int>(rightRow[j]);
+                                out0[j] = static_cast<int>(static_cast<unsigned int>(out0[j]) + a0 * b);
+                                out1[j] = static_cast<int>(static_cast<unsigned int>(out1[j]) + a1 * b);
+                                out2[j] = static_cast<int>(static_cast<unsigned int>(out2[j]) + a2 * b);
+                                out3[j] = static_cast<int>(static_cast<unsigned int>(out3[j]) + a3 * b);
+                            }
+                        }
+                    }
+                    for (; i < iEnd; i++)
+                    {
+                        int *outRow = out + i * outStride + jj;
+                        for (size_t k = kk; k < kEnd; k++)
+                        {
+                            const unsigned int a = static_cast<unsigned int>(left[i * leftStride + k]);
+                            if (a == 0)
+                            {
+                                continue;
+                            }
+                            const int *rightRow = right + k * rightStride + jj;
+                            for (size_t j = 0; j < width; j++)
+                            {
+                                outRow[j] = static_cast<int>(static_cast<unsigned int>(outRow[j]) + a * static_cast<unsigned int>(rightRow[j]));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Row by row i-k-j product into a row of exact sums, narrowed once the row is complete
+    template <typename Sum>
+    static bool multiplyRowsWide(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd, bool saturate)
+    {
+        vector<Sum> sums(n);
+        bool overflow = false;
+        for (size_t i = rowBegin; i < rowEnd; i++)
+        {
+            fill(sums.begin(), sums.end(), Sum(0));
+            for (size_t k = 0; k < n; k++)
+            {
+                const Sum a = left[i * stride + k];
+                if (a == 0)
+                {
+                    continue;
+                }
+                const int *rightRow = right + k * stride;
+                for (size_t j = 0; j < n; j++)
+                {
+                    sums[j] += a * rightRow[j];
+                }
+            }
+            int *outRow = out + i * stride;
+            for (size_t j = 0; j < n; j++)
+            {
+                outRow[j] = narrowCell(sums[j], saturate, overflow);
+            }
+        }
+        return overflow;
+    }
+
+    bool MatrixKernels::multiplyWide(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd,
+                                     bool saturate, bool hugeSums)
+    {
+        if (hugeSums)
+        {
+            return multiplyRowsWide<__int128>(left, right, out, n, stride, rowBegin, rowEnd, saturate);
+        }
+        return multiplyRowsWide<long long>(left, right, out, n, stride, rowBegin, rowEnd, saturate);
+    }
+
+    void MatrixKernels::combineBlocks(const int *x, size_t xStride, const int *y, size_t yStride, int *out, size_t outStride, size_t n, int sign)
+    {
+        const ElementwiseTable &kernels = elementwise();
+        for (size_t i = 0; i < n; i++)
+        {
+            if (sign > 0)
+            {
+                kernels.add(x + i * xStride, y + i * yStride, out + i * outStride, n);
+            }
+            else
+            {
+                kernels.subtract(x + i * xStride, y + i * yStride, out + i * outStride, n);
+            }
+        }
+    }
+
+    void MatrixKernels::multiplyStrassen(const int *left, const int *right, int *out, size_t n, size_t stride, size_t leafSize, ThreadPool *pool)
+    {
+        // Smallest number of halvings that brings the blocks down to the leaf size; the leaf
+        // order is rounded to whole cache lines so every quadrant row stays aligned
+        size_t levels = 0;
+        while (((n + (size_t(1) << levels) - 1) >> levels) > leafSize)
+        {
+            levels++;
+        }
+        const size_t lineCells = 64 / sizeof(int);
+        const size_t block = (n + (size_t(1) << levels) - 1) >> levels;
+        const size_t leaf = (block + lineCells - 1) / lineCells * lineCells;
+        const size_t padded = leaf << levels;
+        // Temporaries take 3/4 of the order squared at the top level and a quarter of that below, less than padded^2 in all
+        std::vector<int, AlignedAllocator<int>> scratch(padded * padded);
+        if (padded == n)
+        {
+            strassenStep(left, stride, right, stride, out, stride, n, leafSize, scratch.data(), pool);
+            return;
+        }
+        // Zero-padded copies; the padding rows and columns add nothing to the product
+        std::vector<int, AlignedAllocator<int>> cells(3 * padded * padded, 0);
+        int *paddedLeft = cells.data();
+        int *paddedRight = paddedLeft + padded * padded;
+        int *paddedOut = paddedRight + padded * padded;
+        for (size_t i = 0; i < n; i++)
+        {
+            copy(left + i * stride, left + i * stride + n, paddedLeft + i * padded);
+            copy(right + i * stride, right + i * stride + n, paddedRight + i * padded);
+        }
+        strassenStep(paddedLeft, padded, paddedRight, padded, paddedOut, padded, padded, leafSize, scratch.data(), pool);
+        for (size_t i = 0; i < n; i++)
+        {
+            copy(paddedOut + i * padded, paddedOut + i * padded + n, out + i * stride);
+        }
+    }
+
+    void MatrixKernels::strassenStep(const int *left, size_t leftStride, const int *right, size_t rightStride, int *out, size_t outStride,
+                                     size_t n, size_t leafSize, int *scratch, ThreadPool *pool)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            fill(out + i * outStride, out + i * outStride + n, 0);
+        }
+        if (n <= leafSize || n % 2 != 0)
+        {
+            const size_t rowBlock = 64;
+            if (pool != nullptr && n > rowBlock)
+            {
+                pool->parallelFor(n, rowBlock, [=](size_t begin, size_t end)
+                                  { multiplyBlocks(left, leftStride, right, rightStride, out, outStride, n, begin, end); });
+            }
+            else
+            {
+                multiplyBlocks(left, leftStride, right, rightStride, out, outStride, n, 0, n);
+            }
+            return;
+        }
+        const size_t h = n / 2;
+        const int *a11 = left;
+        const int *a12 = left + h;
+        const int *a21 = left + h * leftStride;
+        const int *a22 = a21 + h;
+        const int *b11 = right;
+        const int *b12 = right + h;
+        const int *b21 = right + h * rightStride;
+        const int *b22 = b21 + h;
+        int *c11 = out;
+        int *c12 = out + h;
+        int *c21 = out + h * outStride;
+        int *c22 = c21 + h;
+        // Two operand sums and one product live at this level; the levels below use the rest of the arena
+        int *t1 = scratch;
+        int *t2 = t1 + h * h;
+        int *m = t2 + h * h;
+        int *below = m + h * h;
+
+        // M1 = (A11 + A22)(B11 + B22), added to C11 and C22
+        combineBlocks(a11, leftStride, a22, leftStride, t1, h, h, 1);
+        combineBlocks(b11, rightStride, b22, rightStride, t2, h, h, 1);
+        strassenStep(t1, h, t2, h, m, h, h, leafSize, below, pool);
+        combineBlocks(c11, outStride, m, h, c11, outStride, h, 1);
+        combineBlocks(c22, outStride, m, h, c22, outStride, h, 1);
+        // M2 = (A21 + A22) B11, added to C21 and subtracted from C22
+        combineBlocks(a21, leftStride, a22, leftStride, t1, h, h, 1);
+        strassenStep(t1, h, b11, rightStride, m, h, h, leafSize, below, pool);
+        combineBlocks(c21, outStride, m, h, c21, outStride, h, 1);
+        combineBlocks(c22, outStride, m, h, c22, outStride, h, -1);
+        // M3 = A11 (B12 - B22), added to C12 and C22
+        combineBlocks(b12, rightStride, b22, rightStride, t2, h, h, -1);
+        strassenStep(a11, leftStride, t2, h, m, h, h, leafSize, below, pool);
+        combineBlocks(c12, outStride, m, h, c12, outStride, h, 1);
+        combineBlocks(c22, outStride, m, h, c22, outStride, h, 1);
+        // M4 = A22 (B21 - B11), added to C11 and C21
+        combineBlocks(b21, rightStride, b11, rightStride, t2, h, h, -1);
+        strassenStep(a22, leftStride, t2, h, m, h, h, leafSize, below, pool);
+        combineBlocks(c11, outStride, m, h, c11, outStride, h, 1);
+        combineBlocks(c21, outStride, m, h, c21, outStride, h, 1);
+        // M5 = (A11 + A12) B22, subtracted from C11 and added to C12
+        combineBlocks(a11, leftStride, a12, leftStride, t1, h, h, 1);
+        strassenStep(t1, h, b22, rightStride, m, h, h, leafSize, below, pool);
+        combineBlocks(c11, outStride, m, h, c11, outStride, h, -1);
+        combineBlocks(c12, outStride, m, h, c12, outStride, h, 1);
+        // M6 = (A21 - A11)(B11 + B12), added to C22
+        combineBlocks(a21, leftStride, a11, leftStride, t1, h, h, -1);
+        combineBlocks(b11, rightStride, b12, rightStride, t2, h, h, 1);
+        strassenStep(t1, h, t2, h, m, h, h, leafSize, below, pool);
+        combineBlocks(c22, outStride, m, h, c22, outStride, h, 1);
+        // M7 = (A12 - A22)(B21 + B22), added to C11
+        combineBlocks(a12, leftStride, a22, leftStride, t1, h, h, -1);
+        combineBlocks(b21, rightStride, b22, rightStride, t2, h, h, 1);
+        strassenStep(t1, h, t2, h, m, h, h, leafSize, below, pool);
+        combineBlocks(c11, outStride, m, h, c11, outStride, h, 1);
+    }
+
+    bool MatrixKernels::multiplyMinPlus(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd)
+    {
+        const ElementwiseTable &kernels = elementwise();
+        bool overflow = false;
+        for (size_t i = rowBegin; i < rowEnd; i++)
+        {
+            int *outRow = out + i * stride;
+            for (size_t k = 0; k < n; k++)
+            {
+                const int a = left[i * stride + k];
+                if (a != Unreachable)
+                {
+                    overflow |= kernels.minPlus(right + k * stride, outRow, n, a);
+                }
+            }
+        }
+        return overflow;
+    }
+}
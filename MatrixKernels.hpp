@@ -0,0 +1,210 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef MATRIX_KERNELS_HPP
+#define MATRIX_KERNELS_HPP
+
+#include <climits>
+#include <cstddef>
+
+namespace ariel
+{
+    class ThreadPool;
+
+    /**
+     * @brief Low-level loops over row-major int matrices, shared by the Graph operators.
+     *
+     * The kernels work on raw rows with an explicit stride (ints between the starts of two
+     * rows), so they can run on the padded Graph buffer without copying it.
+     */
+    class MatrixKernels
+    {
+    public:
+        /**
+         * @brief Adds rows [rowBegin, rowEnd) of left * right to out.
+         *
+         * Cache-tiled i-k-j product: the k and j loops are blocked so a tile of right stays in
+         * cache while it is reused by a block of rows, and four rows of out are updated together
+         * so each cell of right is loaded once per four multiply-adds. out must be zeroed by the
+         * caller; the diagonal is not treated specially. Sums wrap modulo 2^32.
+         *
+         * @param left The left operand, n x n.
+         * @param right The right operand, n x n.
+         * @param out The result, n x n.
+         * @param n The matrix order.
+         * @param stride The row stride shared by the three matrices.
+         * @param rowBegin The first row of out to compute.
+         * @param rowEnd One past the last row of out to compute.
+         */
+        static void multiply(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd);
+
+        /**
+         * @brief Writes left * right to out with Strassen's recursion.
+         *
+         * The matrices are split into quadrants and multiplied with 7 half-size products instead
+         * of 8, down to blocks of at most leafSize rows, which go to the tiled kernel. The order is
+         * padded with zeros to leafSize-sized blocks times a power of two when it does not split
+         * evenly. Temporaries of every level are carved from one scratch arena of padded^2 cells,
+         * allocated once per call. The quadrant sums can leave the int range even when the product
+         * fits (M1 = (A11 + A22)(B11 + B22) reaches four times the largest cell of a plain sum), so
+         * every sum, difference and leaf product is taken modulo 2^32 in unsigned arithmetic. The
+         * low 32 bits of each cell are therefore exact and the result is identical to multiply().
+         * out is overwritten.
+         *
+         * @param left The left operand, n x n.
+         * @param right The right operand, n x n.
+         * @param out The result, n x n.
+         * @param n The matrix order.
+         * @param stride The row stride shared by the three matrices.
+         * @param leafSize The largest block multiplied directly; at least 16.
+         * @param pool Runs the rows of each leaf product in parallel when not null.
+         */
+        static void multiplyStrassen(const int *left, const int *right, int *out, size_t n, size_t stride, size_t leafSize, ThreadPool *pool);
+
+        // Cell value of a min-plus operand or result that has no walk
+        static const int Unreachable = INT_MAX;
+
+        /**
+         * @brief Computes rows [rowBegin, rowEnd) of the min-plus (tropical) product of left and right.
+         *
+         * out(i, j) = min over k of left(i, k) + right(k, j), where cells equal to Unreachable take
+         * no part. Row i of out is folded with one vectorized minPlus call per reachable k. out must
+         * be filled with Unreachable by the caller. A finite sum outside the int range never wraps:
+         * it is clamped to INT_MIN, or to Unreachable - 1 so it stays a walk.
+         *
+         * @param left The left operand, n x n.
+         * @param right The right operand, n x n.
+         * @param out The result, n x n.
+         * @param n The matrix order.
+         * @param stride The row stride shared by the three matrices.
+         * @param rowBegin The first row of out to compute.
+         * @param rowEnd One past the last row of out to compute.
+         * @return True when some finite sum was clamped.
+         */
+        static bool multiplyMinPlus(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd);
+
+        /*
+         * Element-wise kernels over one contiguous run of cells. Each has AVX-512, AVX2 and
+         * SSE2 builds; the widest one the CPU supports is picked once, at the first call.
+         * out may be the same array as an input.
+         */
+
+        // out = left + right
+        static void add(const int *left, const int *right, int *out, size_t length);
+        // out = left - right
+        static void subtract(const int *left, const int *right, int *out, size_t length);
+        // out = -cells
+        static void negate(const int *cells, int *out, size_t length);
+        // out = cells + value
+        static void addScalar(const int *cells, int *out, size_t length, int value);
+        // out = cells * scalar
+        static void multiplyScalar(const int *cells, int *out, size_t length, int scalar);
+
+        /**
+         * @brief A non-zero divisor prepared for division by multiplication.
+         *
+         * Dividing by a constant d is a multiply-high by a 32-bit magic number, an optional
+         * add or subtract of the dividend and an arithmetic shift (Hacker's Delight, 10-1).
+         * The magic number is computed once here and reused for every cell.
+         */
+        struct Reciprocal
+        {
+            explicit Reciprocal(int divisor);
+
+            int divisor;
+            int multiplier;
+            int correction; // 1 adds the dividend to the multiply-high, -1 subtracts it, 0 neither
+            int shift;
+        };
+
+        // out = cells / divisor, truncated toward zero like int division; vectorized multiply-high, no divide instruction
+        static void divideScalar(const int *cells, int *out, size_t length, const Reciprocal &divisor);
+        // Same with a divisor prepared for this call only; scalar must not be 0
+        static void divideScalar(const int *cells, int *out, size_t length, int scalar);
+        // out = min(out, cells + weight), skipping cells equal to Unreachable; sums are clamped like
+        // multiplyMinPlus, and the return value tells whether any was
+        static bool minPlus(const int *cells, int *out, size_t length, int weight);
+
+        /**
+         * @brief Overflow-aware element-wise kernel: out = xFactor * x + yFactor * y + offset.
+         *
+         * Every lane is widened to 64 bits, so the exact value is known before it is narrowed
+         * back to an int. Values outside the int range are clamped to INT_MIN or INT_MAX when
+         * saturate is set and wrap around otherwise.
+         *
+         * @param x The first run.
+         * @param y The second run, or nullptr for no second term.
+         * @param out The result; may be the same array as x or y.
+         * @param length The number of cells.
+         * @param xFactor The factor of x.
+         * @param yFactor The factor of y.
+         * @param offset The constant added to every cell.
+         * @param saturate Whether out-of-range cells are clamped.
+         * @return True when some cell was outside the int range.
+         */
+        static bool combineWide(const int *x, const int *y, int *out, size_t length, int xFactor, int yFactor, int offset, bool saturate);
+
+        /**
+         * @brief Rows [rowBegin, rowEnd) of left * right with 64-bit (or 128-bit) accumulators.
+         *
+         * The sums are narrowed like combineWide. Unlike multiply(), out is overwritten instead of
+         * added to. 64-bit sums are exact while every partial sum fits in a long long; hugeSums
+         * switches to 128-bit sums for operands whose products could exceed that.
+         *
+         * @return True when some cell was outside the int range.
+         */
+        static bool multiplyWide(const int *left, const int *right, int *out, size_t n, size_t stride, size_t rowBegin, size_t rowEnd,
+                                 bool saturate, bool hugeSums);
+
+        // The non-zero cells of a run: how many there are and their smallest and largest value
+        struct RunSummary
+        {
+            size_t nonZero;
+            int minWeight; // INT_MAX when there are no non-zero cells
+            int maxWeight; // INT_MIN when there are no non-zero cells
+        };
+        static RunSummary summarize(const int *cells, size_t length);
+
+        /**
+         * @brief Returns the instruction set used by the element-wise kernels.
+         *
+         * @return "avx512", "avx2" or "sse2" ("generic" on CPUs other than x86).
+         */
+        static const char *getInstructionSet();
+
+    private:
+        // One build of every element-wise kernel
+        struct ElementwiseTable
+        {
+            const char *name;
+            void (*add)(const int *, const int *, int *, size_t);
+            void (*subtract)(const int *, const int *, int *, size_t);
+            void (*negate)(const int *, int *, size_t);
+            void (*addScalar)(const int *, int *, size_t, int);
+            void (*multiplyScalar)(const int *, int *, size_t, int);
+            void (*divideScalar)(const int *, int *, size_t, const Reciprocal &);
+            bool (*minPlus)(const int *, int *, size_t, int);
+            bool (*combineWide)(const int *, const int *, int *, size_t, int, int, int, bool);
+            RunSummary (*summarize)(const int *, size_t);
+        };
+        // The build chosen for this CPU
+        static const ElementwiseTable &elementwise();
+
+        // The tiled product with a stride per matrix, so it can run on quadrants of larger matrices
+        static void multiplyBlocks(const int *left, size_t leftStride, const int *right, size_t rightStride, int *out, size_t outStride,
+                                   size_t n, size_t rowBegin, size_t rowEnd);
+        // One level of Strassen's recursion on n x n blocks; scratch holds n * n cells for this level and the ones below
+        static void strassenStep(const int *left, size_t leftStride, const int *right, size_t rightStride, int *out, size_t outStride,
+                                 size_t n, size_t leafSize, int *scratch, ThreadPool *pool);
+        // out = x + sign * y over n x n blocks, row by row with the element-wise kernels
+        static void combineBlocks(const int *x, size_t xStride, const int *y, size_t yStride, int *out, size_t outStride, size_t n, int sign);
+
+        // Tile sizes, in rows of out, rows of right and columns of right
+        static const size_t TileRows = 64;
+        static const size_t TileDepth = 128;
+        static const size_t TileColumns = 512;
+    };
+}
+
+#endif
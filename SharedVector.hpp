@@ -0,0 +1,102 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef SHARED_VECTOR_HPP
+#define SHARED_VECTOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Copy-on-write wrapper around std::vector.
+     *
+     * Copies share one reference-counted vector, so copying is O(1). Every non-const
+     * accessor first makes the vector private to this object, copying it only if another
+     * object still shares it. Const accessors never copy, so code that only reads a
+     * shared vector should go through a const reference.
+     *
+     * Different objects that share a vector may be used from different threads, as if each
+     * held its own copy. One object is no more thread safe than a std::vector: it must not
+     * be written while another thread reads, copies or writes the same object.
+     *
+     * @tparam T The element type.
+     * @tparam Allocator The allocator of the underlying vector.
+     */
+    template <typename T, typename Allocator = std::allocator<T>>
+    class SharedVector
+    {
+    public:
+        typedef std::vector<T, Allocator> Vector;
+
+        // The contents, without copying
+        const Vector &read() const { return cells ? *cells : none(); }
+
+        // The contents, private to this object, for writing
+        Vector &write()
+        {
+            if (!cells)
+            {
+                cells = std::make_shared<Vector>();
+            }
+            else if (cells.use_count() != 1)
+            {
+                cells = std::make_shared<Vector>(*cells);
+            }
+            else
+            {
+                // use_count() is a relaxed load; the fence pairs with the release decrement of
+                // the last other owner, so its reads finish before the contents are written in place
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *cells;
+        }
+
+        // True when another object holds the same contents
+        bool isShared() const { return cells && cells.use_count() > 1; }
+
+        size_t size() const { return read().size(); }
+        bool empty() const { return read().empty(); }
+        const T *data() const { return read().data(); }
+        T *data() { return write().data(); }
+        const T &operator[](size_t index) const { return read()[index]; }
+        T &operator[](size_t index) { return write()[index]; }
+        typename Vector::const_iterator begin() const { return read().begin(); }
+        typename Vector::const_iterator end() const { return read().end(); }
+
+        // Replacing the whole contents never copies the old ones
+        void assign(size_t count, const T &value)
+        {
+            if (isShared())
+            {
+                cells.reset();
+            }
+            write().assign(count, value);
+        }
+        void resize(size_t count) { write().resize(count); }
+        void reserve(size_t count) { write().reserve(count); }
+        void push_back(const T &value) { write().push_back(value); }
+
+        // Takes over a vector built elsewhere
+        void adopt(Vector &&vector) { cells = std::make_shared<Vector>(std::move(vector)); }
+        // Drops this object's reference and leaves it empty
+        void release() { cells.reset(); }
+        void swap(SharedVector &other) { cells.swap(other.cells); }
+
+    private:
+        static const Vector &none()
+        {
+            static const Vector empty;
+            return empty;
+        }
+
+        std::shared_ptr<Vector> cells;
+    };
+}
+
+#endif
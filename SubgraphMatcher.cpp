@@ -0,0 +1,385 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#include "SubgraphMatcher.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+namespace ariel
+{
+    const size_t SubgraphMatcher::None;
+    const size_t SubgraphMatcher::SubtreesPerThread;
+
+    // Number of set bits in each row of a bit matrix
+    static vector<size_t> rowDegrees(const BitGraph &graph)
+    {
+        vector<size_t> degrees(graph.getnumVertices(), 0);
+        for (size_t v = 0; v < degrees.size(); v++)
+        {
+            const BitGraph::Word *cells = graph.row(v);
+            for (size_t w = 0; w < graph.getWordsPerRow(); w++)
+            {
+                degrees[v] += static_cast<size_t>(__builtin_popcountll(cells[w]));
+            }
+        }
+        return degrees;
+    }
+
+    SubgraphMatcher::SubgraphMatcher(const Graph &pattern, const Graph &target)
+        : pattern(pattern), target(target), patternVertices(pattern.getnumVertices()), targetVertices(target.getnumVertices()),
+          words(BitGraph::wordsFor(target.getnumVertices()))
+    {
+        this->reversed = this->target.transposed();
+        this->patternOut = rowDegrees(this->pattern);
+        this->patternIn = rowDegrees(this->pattern.transposed());
+        this->targetOut = rowDegrees(this->target);
+        this->targetIn = rowDegrees(this->reversed);
+    }
+
+    bool SubgraphMatcher::passesCounts() const
+    {
+        if (this->patternVertices > this->targetVertices)
+        {
+            return false;
+        }
+        // The i-th largest degree of the pattern cannot exceed the i-th largest degree of the target
+        const vector<size_t> *degrees[][2] = {{&this->patternOut, &this->targetOut}, {&this->patternIn, &this->targetIn}};
+        for (const auto &pair : degrees)
+        {
+            vector<size_t> small = *pair[0];
+            vector<size_t> large = *pair[1];
+            sort(small.begin(), small.end(), greater<size_t>());
+            sort(large.begin(), large.end(), greater<size_t>());
+            for (size_t i = 0; i < small.size(); i++)
+            {
+                if (small[i] > large[i])
+                {
+                    return false;
+                }
+            }
+        }
+        size_t patternLoops = 0;
+        size_t targetLoops = 0;
+        for (size_t v = 0; v < this->patternVertices; v++)
+        {
+            if (this->pattern.isAdjacent(v, v))
+            {
+                patternLoops++;
+            }
+        }
+        for (size_t v = 0; v < this->targetVertices; v++)
+        {
+            if (this->target.isAdjacent(v, v))
+            {
+                targetLoops++;
+            }
+        }
+        return patternLoops <= targetLoops;
+    }
+
+    void SubgraphMatcher::buildDomains()
+    {
+        this->allowed.assign(this->patternVertices * this->words, 0);
+        for (size_t p = 0; p < this->patternVertices; p++)
+        {
+            BitGraph::Word *domain = this->allowed.data() + p * this->words;
+            const bool loop = this->pattern.isAdjacent(p, p);
+            for (size_t t = 0; t < this->targetVertices; t++)
+            {
+                if (this->targetOut[t] >= this->patternOut[p] && this->targetIn[t] >= this->patternIn[p] && (!loop || this->target.isAdjacent(t, t)))
+                {
+                    domain[t / BitGraph::WordBits] |= BitGraph::Word(1) << (t % BitGraph::WordBits);
+                }
+            }
+        }
+    }
+
+    void SubgraphMatcher::buildOrder()
+    {
+        const size_t n = this->patternVertices;
+        this->order.clear();
+        this->earlierOut.assign(n, vector<size_t>());
+        this->earlierIn.assign(n, vector<size_t>());
+        this->laterOut.assign(n, vector<size_t>());
+        this->laterIn.assign(n, vector<size_t>());
+        vector<bool> ordered(n, false);
+        // Edges from each unordered vertex to the ordered ones, in either direction
+        vector<size_t> links(n, 0);
+        for (size_t depth = 0; depth < n; depth++)
+        {
+            // Most links first, then the highest degree, so constrained vertices are matched early
+            size_t best = None;
+            for (size_t v = 0; v < n; v++)
+            {
+                if (ordered[v])
+                {
+                    continue;
+                }
+                if (best == None || links[v] > links[best] ||
+                    (links[v] == links[best] && this->patternOut[v] + this->patternIn[v] > this->patternOut[best] + this->patternIn[best]))
+                {
+                    best = v;
+                }
+            }
+            ordered[best] = true;
+            this->order.push_back(best);
+            for (size_t v = 0; v < n; v++)
+            {
+                const bool out = this->pattern.isAdjacent(best, v);
+                const bool in = this->pattern.isAdjacent(v, best);
+                if (v == best || (!out && !in))
+                {
+                    continue;
+                }
+                if (ordered[v])
+                {
+                    if (out)
+                    {
+                        this->earlierOut[depth].push_back(v);
+                    }
+                    if (in)
+                    {
+                        this->earlierIn[depth].push_back(v);
+                    }
+                }
+                else
+                {
+                    if (out)
+                    {
+                        this->laterOut[depth].push_back(v);
+                    }
+                    if (in)
+                    {
+                        this->laterIn[depth].push_back(v);
+                    }
+                    links[v]++;
+                }
+            }
+        }
+    }
+
+    void SubgraphMatcher::narrowDomain(State &state, size_t depth) const
+    {
+        BitGraph::Word *domain = state.domains.data() + depth * this->words;
+        const BitGraph::Word *start = this->allowed.data() + this->order[depth] * this->words;
+        for (size_t w = 0; w < this->words; w++)
+        {
+            domain[w] = start[w] & ~state.used[w];
+        }
+        // An edge v -> q needs an in-neighbor of q's image, an edge q -> v an out-neighbor
+        for (size_t other : this->earlierOut[depth])
+        {
+            const BitGraph::Word *row = this->reversed.row(state.mapping[other]);
+            for (size_t w = 0; w < this->words; w++)
+            {
+                domain[w] &= row[w];
+            }
+        }
+        for (size_t other : this->earlierIn[depth])
+        {
+            const BitGraph::Word *row = this->target.row(state.mapping[other]);
+            for (size_t w = 0; w < this->words; w++)
+            {
+                domain[w] &= row[w];
+            }
+        }
+    }
+
+    size_t SubgraphMatcher::nextSet(const BitGraph::Word *bits, size_t from) const
+    {
+        if (from >= this->targetVertices)
+        {
+            return this->targetVertices;
+        }
+        size_t w = from / BitGraph::WordBits;
+        BitGraph::Word word = bits[w] & (~BitGraph::Word(0) << (from % BitGraph::WordBits));
+        while (word == 0)
+        {
+            if (++w == this->words)
+            {
+                return this->targetVertices;
+            }
+            word = bits[w];
+        }
+        return w * BitGraph::WordBits + static_cast<size_t>(__builtin_ctzll(word));
+    }
+
+    bool SubgraphMatcher::tryAssign(State &state, size_t depth, size_t candidate) const
+    {
+        const size_t word = candidate / BitGraph::WordBits;
+        const BitGraph::Word bit = BitGraph::Word(1) << (candidate % BitGraph::WordBits);
+        state.mapping[this->order[depth]] = candidate;
+        state.used[word] |= bit;
+        // Every unmapped neighbor must keep a free target among the candidate's neighbors
+        const BitGraph::Word *rows[] = {this->target.row(candidate), this->reversed.row(candidate)};
+        const vector<size_t> *later[] = {&this->laterOut[depth], &this->laterIn[depth]};
+        for (size_t side = 0; side < 2; side++)
+        {
+            for (size_t other : *later[side])
+            {
+                const BitGraph::Word *domain = this->allowed.data() + other * this->words;
+                BitGraph::Word any = 0;
+                for (size_t w = 0; w < this->words && any == 0; w++)
+                {
+                    any = domain[w] & rows[side][w] & ~state.used[w];
+                }
+                if (any == 0)
+                {
+                    unassign(state, depth);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void SubgraphMatcher::unassign(State &state, size_t depth) const
+    {
+        const size_t vertex = this->order[depth];
+        const size_t candidate = state.mapping[vertex];
+        state.used[candidate / BitGraph::WordBits] &= ~(BitGraph::Word(1) << (candidate % BitGraph::WordBits));
+        state.mapping[vertex] = None;
+    }
+
+    SubgraphMatcher::State SubgraphMatcher::stateFor(const vector<size_t> &prefix) const
+    {
+        State state;
+        state.mapping.assign(this->patternVertices, None);
+        state.used.assign(this->words, 0);
+        state.domains.assign(this->patternVertices * this->words, 0);
+        for (size_t depth = 0; depth < prefix.size(); depth++)
+        {
+            state.mapping[this->order[depth]] = prefix[depth];
+            state.used[prefix[depth] / BitGraph::WordBits] |= BitGraph::Word(1) << (prefix[depth] % BitGraph::WordBits);
+        }
+        return state;
+    }
+
+    bool SubgraphMatcher::search(State &state, size_t depth, const atomic<bool> *stop) const
+    {
+        // Depth-first search with an explicit stack: cursor[d] is the next candidate to try at depth d
+        const size_t first = depth;
+        vector<size_t> cursor(this->patternVertices, 0);
+        narrowDomain(state, depth);
+        while (stop == nullptr || !stop->load(memory_order_relaxed))
+        {
+            // Coming back to a depth undoes the assignment made there
+            if (state.mapping[this->order[depth]] != None)
+            {
+                unassign(state, depth);
+            }
+            const BitGraph::Word *domain = state.domains.data() + depth * this->words;
+            size_t candidate = nextSet(domain, cursor[depth]);
+            while (candidate < this->targetVertices && !tryAssign(state, depth, candidate))
+            {
+                candidate = nextSet(domain, candidate + 1);
+            }
+            if (candidate == this->targetVertices)
+            {
+                if (depth == first)
+                {
+                    return false;
+                }
+                depth--;
+                continue;
+            }
+            cursor[depth] = candidate + 1;
+            if (depth + 1 == this->patternVertices)
+            {
+                return true;
+            }
+            depth++;
+            cursor[depth] = 0;
+            narrowDomain(state, depth);
+        }
+        return false;
+    }
+
+    bool SubgraphMatcher::searchParallel(ThreadPool &pool)
+    {
+        // Expands the search tree level by level until there are enough subtrees to share;
+        // a prefix holds the targets of the first vertices of the order
+        const size_t wanted = pool.getThreadCount() * SubtreesPerThread;
+        vector<vector<size_t>> prefixes(1);
+        size_t depth = 0;
+        while (prefixes.size() < wanted && depth < this->patternVertices)
+        {
+            vector<vector<size_t>> expanded;
+            for (const vector<size_t> &prefix : prefixes)
+            {
+                State state = stateFor(prefix);
+                narrowDomain(state, depth);
+                const BitGraph::Word *domain = state.domains.data() + depth * this->words;
+                for (size_t candidate = nextSet(domain, 0); candidate < this->targetVertices; candidate = nextSet(domain, candidate + 1))
+                {
+                    if (tryAssign(state, depth, candidate))
+                    {
+                        unassign(state, depth);
+                        expanded.push_back(prefix);
+                        expanded.back().push_back(candidate);
+                    }
+                }
+            }
+            prefixes.swap(expanded);
+            depth++;
+            if (prefixes.empty())
+            {
+                return false;
+            }
+        }
+        if (depth == this->patternVertices)
+        {
+            this->result = stateFor(prefixes.front());
+            return true;
+        }
+
+        // Threads take the next subtree from the pool's counter; the first embedding stops the rest
+        atomic<bool> found(false);
+        atomic<bool> *stop = &found;
+        State *winner = &this->result;
+        const vector<vector<size_t>> *subtrees = &prefixes;
+        pool.parallelFor(prefixes.size(), 1, [=](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end && !stop->load(memory_order_relaxed); i++)
+            {
+                State state = stateFor((*subtrees)[i]);
+                // Only the first thread to succeed publishes its mapping
+                if (search(state, depth, stop) && !stop->exchange(true))
+                {
+                    *winner = state;
+                }
+            } });
+        return found;
+    }
+
+    bool SubgraphMatcher::find(ThreadPool *pool)
+    {
+        this->result = State();
+        this->result.mapping.assign(this->patternVertices, None);
+        if (!passesCounts())
+        {
+            return false;
+        }
+        if (this->patternVertices == 0)
+        {
+            return true;
+        }
+        buildDomains();
+        buildOrder();
+        this->result = stateFor(vector<size_t>());
+        if (pool != nullptr && pool->getThreadCount() > 1)
+        {
+            return searchParallel(*pool);
+        }
+        return search(this->result, 0, nullptr);
+    }
+
+    const vector<size_t> &SubgraphMatcher::getMapping() const
+    {
+        return this->result.mapping;
+    }
+}
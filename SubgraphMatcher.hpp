@@ -0,0 +1,123 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef SUBGRAPH_MATCHER_HPP
+#define SUBGRAPH_MATCHER_HPP
+
+#include "BitGraph.hpp"
+#include "Graph.hpp"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace ariel
+{
+    class ThreadPool;
+
+    /**
+     * @brief State-space search for a copy of one graph inside another (VF2-style).
+     *
+     * Looks for an injective map from the vertices of the pattern to the vertices of the
+     * target that sends every edge of the pattern, self loops included, onto an edge of the
+     * target. Weights are ignored and the target may have extra edges (a monomorphism).
+     *
+     * The pattern vertices are matched one at a time in a fixed order: each next vertex is
+     * the one with the most edges to the vertices already ordered, so the search is anchored
+     * early. Every pattern vertex has a bitset domain of the target vertices with enough in-
+     * and out-degree (and a self loop when it has one). Entering a depth ANDs that domain with
+     * the free targets and with the target rows of the images of its mapped neighbors, 64
+     * candidates per word, so every set bit left is consistent with the mapping so far. A
+     * candidate is then kept only if each unmapped neighbor of the vertex still has a candidate
+     * among the candidate's neighbors (forward checking).
+     *
+     * With a thread pool, the first levels of the search tree are expanded into many partial
+     * mappings, and the pool's threads take the subtrees below them one at a time, so a thread
+     * that finishes a small subtree moves on to the next. The first embedding found stops the
+     * other threads.
+     */
+    class SubgraphMatcher
+    {
+    public:
+        /**
+         * @brief Prepares the search; no matching is done yet.
+         *
+         * @param pattern The graph to look for.
+         * @param target The graph to look in.
+         */
+        SubgraphMatcher(const Graph &pattern, const Graph &target);
+
+        /**
+         * @brief Runs the search.
+         *
+         * @param pool Splits the search tree between its threads when not null.
+         * @return True when the target contains a copy of the pattern.
+         */
+        bool find(ThreadPool *pool = nullptr);
+
+        // Image of every pattern vertex after find() returned true
+        const std::vector<size_t> &getMapping() const;
+
+    private:
+        static const size_t None = static_cast<size_t>(-1);
+
+        BitGraph pattern;
+        BitGraph target;
+        // The target with every edge reversed, for the in-neighbors of a vertex
+        BitGraph reversed;
+        size_t patternVertices;
+        size_t targetVertices;
+        // Out- and in-degrees, self loops included
+        std::vector<size_t> patternOut;
+        std::vector<size_t> patternIn;
+        std::vector<size_t> targetOut;
+        std::vector<size_t> targetIn;
+
+        // Words of one target bitset
+        size_t words;
+        // Row p holds the targets that pass the degree and self loop tests for pattern vertex p
+        std::vector<BitGraph::Word> allowed;
+
+        // Position in the matching order -> pattern vertex
+        std::vector<size_t> order;
+        // Earlier vertices of the order with an edge from (out) or to (in) the vertex at each position
+        std::vector<std::vector<size_t>> earlierOut;
+        std::vector<std::vector<size_t>> earlierIn;
+        // Later vertices of the order with an edge from (out) or to (in) the vertex at each position
+        std::vector<std::vector<size_t>> laterOut;
+        std::vector<std::vector<size_t>> laterIn;
+
+        // A partial mapping; each thread of a parallel search works on its own
+        struct State
+        {
+            std::vector<size_t> mapping;
+            // Targets that are the image of some pattern vertex, one bit each
+            std::vector<BitGraph::Word> used;
+            // Row d holds the candidates of the vertex at depth d, computed when the search enters it
+            std::vector<BitGraph::Word> domains;
+        };
+        State result;
+
+        // Subtrees handed out per thread of a parallel search, so uneven subtrees even out
+        static const size_t SubtreesPerThread = 16;
+
+        // Necessary conditions on edge counts and degree sequences, checked before any search
+        bool passesCounts() const;
+        void buildDomains();
+        void buildOrder();
+        // Fills the domain of the vertex at position depth from its mapped neighbors and the free targets
+        void narrowDomain(State &state, size_t depth) const;
+        // First set bit of a target bitset at or after from, or targetVertices
+        size_t nextSet(const BitGraph::Word *bits, size_t from) const;
+        // Maps the vertex at position depth to candidate when every unmapped neighbor keeps a candidate
+        bool tryAssign(State &state, size_t depth, size_t candidate) const;
+        void unassign(State &state, size_t depth) const;
+        // Maps the vertices at positions [0, prefix.size()) to the targets in prefix
+        State stateFor(const std::vector<size_t> &prefix) const;
+        // Completes state from position depth on; gives up when stop is set
+        bool search(State &state, size_t depth, const std::atomic<bool> *stop) const;
+        bool searchParallel(ThreadPool &pool);
+    };
+}
+
+#endif
@@ -1,6 +1,14 @@
 #include "doctest.h"
 #include "Algorithms.hpp"
 #include "Graph.hpp"
+#include "GraphBuilder.hpp"
+#include "BitGraph.hpp"
+#include "ThreadPool.hpp"
+#include "MatrixKernels.hpp"
+#include "GraphExpression.hpp"
+#include "GraphSorter.hpp"
+#include <algorithm>
+#include <thread>
 
 using namespace std;
 
@@ -947,4 +955,1641 @@ TEST_CASE("Test for * with scalar but reversed")
     g7.loadGraph(grpah2);
     ariel::Graph g8 = 0 * g7;
     CHECK(g8.printGraph() == "[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]");
+}
+
+TEST_CASE("Test row views and edge weights")
+{
+    ariel::Graph g1;
+    vector<vector<int>> graph = {
+        {0, 4, 0},
+        {1, 0, 7},
+        {0, 2, 0}};
+    g1.loadGraph(graph);
+    ariel::Graph::RowView row = g1.row(1);
+    CHECK(row.size() == 3);
+    CHECK(row[0] == 1);
+    CHECK(row[2] == 7);
+    CHECK(g1.getEdgeWeight(2, 1) == 2);
+    CHECK(g1.getAdjacencyMatrix() == graph);
+    // The nested copy is built once and rebuilt after a write
+    CHECK(&g1.getAdjacencyMatrix() == &g1.getAdjacencyMatrix());
+    g1 += g1;
+    CHECK(g1.getAdjacencyMatrix()[1][2] == 14);
+    CHECK(g1.toMatrix() == g1.getAdjacencyMatrix());
+    CHECK_THROWS(g1.row(3));
+    CHECK_THROWS(g1.getEdgeWeight(0, 3));
+}
+
+TEST_CASE("Test sparse storage")
+{
+    vector<vector<int>> graph = {
+        {0, 1, 0, 0},
+        {1, 0, 3, 0},
+        {0, 3, 0, 0},
+        {0, 0, 0, 0}};
+    ariel::Graph dense;
+    dense.loadGraph(graph);
+    ariel::Graph sparse;
+    sparse.loadGraph(graph, ariel::Graph::Storage::Sparse);
+    CHECK(sparse.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(sparse.printGraph() == dense.printGraph());
+    CHECK(sparse.getEdgeWeight(1, 2) == 3);
+    CHECK_FALSE(sparse.isAdjacent(0, 3));
+    CHECK_THROWS(sparse.row(0));
+
+    // Sparse operands keep sparse storage and match the dense results
+    ariel::Graph sum = sparse + sparse;
+    CHECK(sum.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(sum.printGraph() == (dense + dense).printGraph());
+    CHECK((sparse - sparse).printGraph() == "[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]");
+    CHECK((sparse * sparse).printGraph() == (dense * dense).printGraph());
+    CHECK((sparse * dense).printGraph() == (dense * dense).printGraph());
+    CHECK((sparse + dense).printGraph() == (dense + dense).printGraph());
+    CHECK((-sparse).printGraph() == (-dense).printGraph());
+    CHECK((12 / sparse).printGraph() == (12 / dense).printGraph());
+    CHECK(sparse == dense);
+
+    ariel::Graph scaled = sparse * 0;
+    CHECK(scaled.printGraph() == "[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]\n[0, 0, 0, 0]");
+
+    // Incrementing fills the matrix, so the graph becomes dense
+    ++sparse;
+    CHECK(sparse.getStorage() == ariel::Graph::Storage::Dense);
+    CHECK(sparse.printGraph() == (++dense).printGraph());
+
+    // Algorithms see the same graph whatever the storage
+    ariel::Graph path;
+    path.loadGraph(graph, ariel::Graph::Storage::Sparse);
+    CHECK_FALSE(ariel::Algorithms::isConnected(path));
+    CHECK(ariel::Algorithms::shortestPath(path, 0, 2) == "0->1->2");
+    CHECK(ariel::Algorithms::isBipartite(path) == "The graph is bipartite: A={0, 2, 3}, B={1}");
+    CHECK_FALSE(ariel::Algorithms::isContainsCycle(path));
+}
+
+TEST_CASE("Test building graphs from edges")
+{
+    ariel::GraphBuilder builder(4);
+    builder.reserve(4);
+    builder.addUndirectedEdge(0, 1, 2).addEdge(1, 2, 5).addEdge(1, 2, 7).addEdge(3, 0);
+    ariel::Graph g1 = builder.build();
+    CHECK(g1.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(g1.printGraph() == "[0, 2, 0, 0]\n[2, 0, 7, 0]\n[0, 0, 0, 0]\n[1, 0, 0, 0]");
+    CHECK(g1.getIsDirected());
+    CHECK_THROWS(builder.addEdge(0, 4));
+
+    vector<ariel::Graph::WeightedEdge> edges = {{0, 1, 1}, {1, 0, 1}, {2, 1, 3}, {1, 2, 3}, {0, 1, 0}, {1, 0, 0}};
+    ariel::Graph g2;
+    g2.loadEdges(3, std::move(edges));
+    CHECK(g2.printGraph() == "[0, 0, 0]\n[0, 0, 3]\n[0, 3, 0]");
+    CHECK_FALSE(g2.getIsDirected());
+    ariel::Graph::WeightedEdge invalid[] = {{0, 3, 1}};
+    CHECK_THROWS(g2.loadEdges(3, invalid, 1));
+
+    ariel::Graph g3;
+    g3.loadAdjacencyList({{{2, 4}, {1, 1}}, {}, {{0, 4}}});
+    CHECK(g3.printGraph() == "[0, 1, 4]\n[0, 0, 0]\n[4, 0, 0]");
+    CHECK(ariel::Algorithms::shortestPath(g3, 2, 1) == "2->0->1");
+}
+
+TEST_CASE("Test cached graph properties")
+{
+    ariel::Graph g1;
+    vector<vector<int>> graph = {
+        {0, 1, 0},
+        {1, 0, 1},
+        {0, 1, 0}};
+    g1.loadGraph(graph);
+    CHECK(g1.getNumEdges() == 2);
+    CHECK_FALSE(g1.getIsWeighted());
+    CHECK_FALSE(g1.hasNegativeWeights());
+    CHECK_FALSE(g1.hasSelfLoops());
+    CHECK(g1.getMinWeight() == 1);
+    CHECK(g1.getMaxWeight() == 1);
+
+    // The properties follow every operator
+    g1 *= -3;
+    CHECK(g1.getIsWeighted());
+    CHECK(g1.hasNegativeWeights());
+    CHECK(g1.getMinWeight() == -3);
+    CHECK(g1.getMaxWeight() == -3);
+    CHECK_FALSE(g1.getIsDirected());
+
+    ariel::Graph g2;
+    vector<vector<int>> directed = {
+        {2, 5, 0},
+        {0, 0, -4},
+        {0, 0, 0}};
+    g2.loadGraph(directed);
+    CHECK(g2.getIsDirected());
+    CHECK(g2.hasSelfLoops());
+    CHECK(g2.getNumEdges() == 3);
+    g1 += g2;
+    CHECK(g1.printGraph() == "[2, 2, 0]\n[-3, 0, -7]\n[0, -3, 0]");
+    CHECK(g1.getIsDirected());
+    CHECK(g1.getNumEdges() == 5);
+    CHECK(g1.getMinWeight() == -7);
+    CHECK(g1.getMaxWeight() == 2);
+
+    ++g2;
+    CHECK_FALSE(g2.hasSelfLoops());
+    CHECK(g2.getNumEdges() == 6);
+    CHECK(g2.getMinWeight() == -3);
+
+    ariel::Graph g3 = g2 * 0;
+    CHECK(g3.getNumEdges() == 0);
+    CHECK_FALSE(g3.getIsDirected());
+    CHECK_FALSE(ariel::Algorithms::isConnected(g3));
+    ariel::Graph g4 = g2 - g2 + g1;
+    CHECK(ariel::Algorithms::isBipartite(g4) == "0");
+}
+
+TEST_CASE("Test symmetric packed storage")
+{
+    ariel::Graph g1;
+    vector<vector<int>> graph = {
+        {0, 2, 0, 4},
+        {2, 0, 3, 0},
+        {0, 3, 0, 1},
+        {4, 0, 1, 0}};
+    g1.loadGraph(graph, ariel::Graph::Storage::Auto);
+    CHECK(g1.getStorage() == ariel::Graph::Storage::Symmetric);
+    CHECK(g1.getAdjacencyMatrix() == graph);
+    CHECK(g1.getEdgeWeight(3, 0) == 4);
+    CHECK(g1.getNumEdges() == 4);
+    CHECK_THROWS(g1.row(0));
+
+    // Neighbours left of the diagonal are read from the mirrored cells
+    vector<size_t> targets;
+    for (const ariel::Graph::Edge &edge : g1.neighbors(2))
+    {
+        targets.push_back(edge.vertex);
+    }
+    CHECK(targets == vector<size_t>{1, 3});
+
+    // Element-wise operators keep the packed layout
+    ariel::Graph g2 = g1 + g1;
+    CHECK(g2.getStorage() == ariel::Graph::Storage::Symmetric);
+    CHECK(g2.printGraph() == "[0, 4, 0, 8]\n[4, 0, 6, 0]\n[0, 6, 0, 2]\n[8, 0, 2, 0]");
+    ++g2;
+    CHECK(g2.printGraph() == "[0, 5, 1, 9]\n[5, 0, 7, 1]\n[1, 7, 0, 3]\n[9, 1, 3, 0]");
+    CHECK(ariel::Algorithms::isConnected(g2));
+
+    // Mixing with a directed graph falls back to full dense storage
+    ariel::Graph g3;
+    vector<vector<int>> directed = {
+        {0, 1, 0, 0},
+        {0, 0, 1, 0},
+        {0, 0, 0, 1},
+        {0, 0, 0, 0}};
+    g3.loadGraph(directed);
+    CHECK(g3.getStorage() == ariel::Graph::Storage::Dense);
+    ariel::Graph g4 = g1 + g3;
+    CHECK(g4.getStorage() == ariel::Graph::Storage::Dense);
+    CHECK(g4.printGraph() == "[0, 3, 0, 4]\n[2, 0, 4, 0]\n[0, 3, 0, 2]\n[4, 0, 1, 0]");
+    ariel::Graph g5 = g1 * g3;
+    CHECK(g5.printGraph() == "[0, 0, 2, 0]\n[0, 0, 0, 3]\n[0, 0, 0, 0]\n[0, 4, 0, 0]");
+    CHECK(g1 * g1 == g1 * g1);
+
+    ariel::Graph g6;
+    CHECK_THROWS(g6.loadGraph(directed, ariel::Graph::Storage::Symmetric));
+}
+
+TEST_CASE("Test bit-packed adjacency")
+{
+    ariel::BitGraph b1;
+    vector<vector<int>> graph = {
+        {0, 1, 0, 0},
+        {1, 0, 1, 0},
+        {0, 1, 0, 0},
+        {0, 0, 0, 0}};
+    b1.loadGraph(graph);
+    CHECK(b1.getWordsPerRow() == 1);
+    CHECK(b1.isAdjacent(1, 2));
+    CHECK_FALSE(b1.isAdjacent(0, 2));
+    CHECK_FALSE(b1.getIsDirected());
+    CHECK_FALSE(ariel::Algorithms::isConnected(b1));
+    CHECK(ariel::Algorithms::isBipartite(b1) == "The graph is bipartite: A={0, 2, 3}, B={1}");
+    CHECK_FALSE(ariel::Algorithms::isContainsCycle(b1));
+    CHECK_THROWS(b1.loadGraph({{0, 1}, {1}}));
+
+    // A 130-vertex ring crosses word boundaries; compare the bitset path with the sparse one
+    ariel::GraphBuilder builder(130);
+    for (size_t i = 0; i < 130; i++)
+    {
+        builder.addUndirectedEdge(i, (i + 1) % 130);
+    }
+    ariel::Graph sparse = builder.build();
+    ariel::Graph dense;
+    dense.loadGraph(sparse.toMatrix());
+    ariel::BitGraph b2(dense);
+    CHECK(b2.getWordsPerRow() == 3);
+    CHECK(b2.isAdjacent(129, 0));
+    CHECK(ariel::Algorithms::isConnected(dense));
+    CHECK(ariel::Algorithms::isConnected(b2));
+    CHECK(ariel::Algorithms::isBipartite(dense) == ariel::Algorithms::isBipartite(sparse));
+    CHECK(ariel::Algorithms::isContainsCycle(b2));
+
+    // Directed: a one-way chain is not connected, closing it into a cycle is
+    ariel::GraphBuilder chain(70);
+    for (size_t i = 0; i + 1 < 70; i++)
+    {
+        chain.addEdge(i, i + 1);
+    }
+    ariel::Graph g1 = chain.build();
+    ariel::BitGraph b3(g1);
+    CHECK(b3.getIsDirected());
+    CHECK_FALSE(ariel::Algorithms::isConnected(b3));
+    CHECK(b3.transposed().isAdjacent(69, 68));
+    for (size_t i = 0; i < 70; i++)
+    {
+        chain.addEdge(i, (i + 1) % 70);
+    }
+    ariel::Graph g2 = chain.build();
+    CHECK(ariel::Algorithms::isConnected(ariel::BitGraph(g2)));
+
+    // An odd cycle is not bipartite
+    ariel::Graph g3;
+    g3.loadGraph({{0, 1, 1}, {1, 0, 1}, {1, 1, 0}});
+    CHECK(ariel::Algorithms::isBipartite(g3) == "0");
+    CHECK(ariel::Algorithms::isContainsCycle(g3));
+}
+
+TEST_CASE("Test blocked graph multiplication")
+{
+    // 531 vertices spans several tiles in every direction and leaves rows outside the four-row blocks
+    const size_t n = 531;
+    vector<vector<int>> left(n, vector<int>(n, 0));
+    vector<vector<int>> right(n, vector<int>(n, 0));
+    unsigned int seed = 7;
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            seed = seed * 1103515245U + 12345U;
+            left[i][j] = static_cast<int>(seed >> 16) % 5 - 2;
+            seed = seed * 1103515245U + 12345U;
+            right[i][j] = static_cast<int>(seed >> 16) % 3;
+        }
+    }
+    vector<vector<int>> expected(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t k = 0; k < n; k++)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                expected[i][j] += left[i][k] * right[k][j];
+            }
+        }
+        expected[i][i] = 0;
+    }
+
+    ariel::Graph g1;
+    g1.loadGraph(left);
+    ariel::Graph g2;
+    g2.loadGraph(right);
+    ariel::Graph g3 = g1 * g2;
+    CHECK(g3.toMatrix() == expected);
+    g1 *= g2;
+    CHECK(g1.toMatrix() == expected);
+}
+
+TEST_CASE("Test parallel graph multiplication")
+{
+    // Every index is visited exactly once, whatever thread takes its chunk
+    ariel::ThreadPool pool(3);
+    CHECK(pool.getThreadCount() == 3);
+    vector<int> hits(1000, 0);
+    pool.parallelFor(hits.size(), 7, [&hits](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; i++)
+                         {
+                             hits[i]++;
+                         } });
+    CHECK(std::count(hits.begin(), hits.end(), 1) == 1000);
+
+    const size_t n = 150;
+    vector<vector<int>> matrix(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            matrix[i][j] = static_cast<int>((i * 7 + j * 3) % 5) - 2;
+        }
+    }
+    ariel::Graph g1;
+    g1.loadGraph(matrix);
+    ariel::Graph serial = g1 * g1;
+
+    ariel::Graph::setThreadCount(3);
+    ariel::Graph::setParallelCutoff(16);
+    CHECK(ariel::Graph::getThreadCount() == 3);
+    ariel::Graph parallel = g1 * g1;
+    CHECK(parallel.toMatrix() == serial.toMatrix());
+    g1 *= g1;
+    CHECK(g1.toMatrix() == serial.toMatrix());
+
+    ariel::Graph::setThreadCount(0);
+    ariel::Graph::setParallelCutoff(256);
+    CHECK(ariel::Graph::getThreadCount() >= 1);
+}
+
+TEST_CASE("Test sparse graph multiplication")
+{
+    // Two-hop paths of a large ring never allocate a V x V buffer
+    const size_t n = 200000;
+    ariel::GraphBuilder builder(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        builder.addEdge(i, (i + 1) % n, 2);
+        builder.addEdge(i, (i + 2) % n, 3);
+    }
+    ariel::Graph ring = builder.build();
+    ariel::Graph twoHops = ring * ring;
+    CHECK(twoHops.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(twoHops.getNumEdges() == 3 * n);
+    CHECK(twoHops.getEdgeWeight(10, 12) == 4);
+    CHECK(twoHops.getEdgeWeight(10, 13) == 12);
+    CHECK(twoHops.getEdgeWeight(10, 14) == 9);
+    CHECK(twoHops.getIsDirected());
+
+    // A hub row takes the dense accumulator, the other rows the hash accumulator
+    const size_t m = 90;
+    vector<vector<int>> matrix(m, vector<int>(m, 0));
+    for (size_t j = 1; j < m; j++)
+    {
+        matrix[0][j] = static_cast<int>(j % 4) - 1;
+    }
+    for (size_t i = 1; i < m; i++)
+    {
+        matrix[i][(i * 7) % m] = 2;
+        matrix[i][(i * 11 + 3) % m] = -1;
+    }
+    ariel::Graph sparse;
+    sparse.loadGraph(matrix, ariel::Graph::Storage::Sparse);
+    ariel::Graph dense;
+    dense.loadGraph(matrix);
+    ariel::Graph product = sparse * sparse;
+    CHECK(product.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(product.toMatrix() == (dense * dense).toMatrix());
+    CHECK(product.getNumEdges() == (dense * dense).getNumEdges());
+    CHECK((sparse * dense).toMatrix() == product.toMatrix());
+
+    // Cancelling products leave no explicit zeros behind
+    ariel::Graph g1;
+    g1.loadGraph({{0, 1, 1, 0}, {0, 0, 0, 1}, {0, 0, 0, -1}, {0, 0, 0, 0}}, ariel::Graph::Storage::Sparse);
+    ariel::Graph g2 = g1 * g1;
+    CHECK(g2.getNumEdges() == 0);
+    CHECK((g1 + g1).getIsDirected());
+}
+
+TEST_CASE("Test vectorized element-wise kernels")
+{
+    string isa = ariel::MatrixKernels::getInstructionSet();
+    CHECK((isa == "avx512" || isa == "avx2" || isa == "sse2" || isa == "generic"));
+
+    // 37 cells: two full 16-cell blocks and a scalar tail
+    vector<int> left(37), right(37), out(37);
+    for (size_t i = 0; i < left.size(); i++)
+    {
+        left[i] = static_cast<int>(i * 13 % 29) - 14;
+        right[i] = static_cast<int>(i % 5) - 2;
+    }
+    ariel::MatrixKernels::add(left.data(), right.data(), out.data(), out.size());
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        CHECK(out[i] == left[i] + right[i]);
+    }
+    ariel::MatrixKernels::subtract(left.data(), right.data(), out.data(), out.size());
+    CHECK(out[36] == left[36] - right[36]);
+    ariel::MatrixKernels::negate(left.data(), out.data(), out.size());
+    CHECK(out[20] == -left[20]);
+    ariel::MatrixKernels::addScalar(left.data(), out.data(), out.size(), -1);
+    CHECK(out[35] == left[35] - 1);
+    ariel::MatrixKernels::multiplyScalar(left.data(), out.data(), out.size(), -7);
+    CHECK(out[17] == left[17] * -7);
+    ariel::MatrixKernels::divideScalar(left.data(), out.data(), out.size(), -3);
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        // Truncation toward zero, as for int division
+        CHECK(out[i] == left[i] / -3);
+    }
+    ariel::MatrixKernels::RunSummary summary = ariel::MatrixKernels::summarize(left.data(), left.size());
+    CHECK(summary.nonZero == static_cast<size_t>(left.size() - static_cast<size_t>(std::count(left.begin(), left.end(), 0))));
+    CHECK(summary.minWeight == *std::min_element(left.begin(), left.end()));
+    CHECK(summary.maxWeight == *std::max_element(left.begin(), left.end()));
+
+    // The Graph operators on a graph wider than one block
+    vector<vector<int>> matrix(40, vector<int>(40, 0));
+    for (size_t i = 0; i < 40; i++)
+    {
+        for (size_t j = 0; j < 40; j++)
+        {
+            matrix[i][j] = (i == j) ? 0 : static_cast<int>((i * 3 + j) % 9) - 4;
+        }
+    }
+    ariel::Graph g1;
+    g1.loadGraph(matrix);
+    ariel::Graph g2 = g1 * 5;
+    g2 /= 2;
+    ++g2;
+    vector<vector<int>> result = g2.toMatrix();
+    CHECK(result[3][7] == matrix[3][7] * 5 / 2 + 1);
+    CHECK(result[39][38] == matrix[39][38] * 5 / 2 + 1);
+    CHECK(result[12][12] == 0);
+    CHECK((g1 - g1).getNumEdges() == 0);
+}
+
+TEST_CASE("Test fused graph expressions")
+{
+    ariel::Graph g1;
+    ariel::Graph g2;
+    ariel::Graph g3;
+    g1.loadGraph({{0, 1, 2}, {1, 0, 3}, {2, 3, 0}}, ariel::Graph::Storage::Auto);
+    g2.loadGraph({{0, 4, 0}, {4, 0, 5}, {0, 5, 0}}, ariel::Graph::Storage::Auto);
+    g3.loadGraph({{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}, ariel::Graph::Storage::Auto);
+
+    // Symmetric operands keep the packed layout and the known symmetry
+    ariel::Graph packed = ariel::lazy(g1) + g2 - 2 * ariel::lazy(g2);
+    CHECK(packed.getStorage() == ariel::Graph::Storage::Symmetric);
+    CHECK(packed == g1 + g2 - 2 * g2);
+    CHECK_FALSE(packed.getIsDirected());
+    CHECK(packed.getNumEdges() == (g1 + g2 - 2 * g2).getNumEdges());
+
+    // Mixing in a directed graph gives a dense result equal to the eager operators
+    ariel::Graph mixed = ariel::lazy(g1) + g2 - 3 * ariel::lazy(g3);
+    CHECK(mixed.getStorage() == ariel::Graph::Storage::Dense);
+    CHECK(mixed.printGraph() == (g1 + g2 - 3 * g3).printGraph());
+    CHECK(mixed.getIsDirected());
+    ariel::Graph negated = -(ariel::lazy(g3) * 2) + g3;
+    CHECK(negated.printGraph() == "[0, -1, 0]\n[0, 0, -1]\n[-1, 0, 0]");
+
+    // The expression may read the graph it is assigned to
+    g1 = ariel::lazy(g1) - g1 + g3;
+    CHECK(g1.printGraph() == g3.printGraph());
+
+    // Sparse operands give a sparse result
+    ariel::Graph s1;
+    ariel::Graph s2;
+    s1.loadGraph({{0, 1, 0}, {1, 0, 0}, {0, 0, 0}}, ariel::Graph::Storage::Sparse);
+    s2.loadGraph({{0, 1, 0}, {0, 0, 2}, {0, 0, 0}}, ariel::Graph::Storage::Sparse);
+    ariel::Graph sparse = ariel::lazy(s1) - s2;
+    CHECK(sparse.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(sparse.printGraph() == "[0, 0, 0]\n[1, 0, -2]\n[0, 0, 0]");
+    CHECK(sparse.getNumEdges() == 2);
+
+    ariel::Graph g4;
+    g4.loadGraph({{0, 1}, {1, 0}});
+    CHECK_THROWS(ariel::Graph(ariel::lazy(g2) + g4));
+}
+
+TEST_CASE("Test derived properties of operator results")
+{
+    ariel::Graph g1;
+    g1.loadGraph({{0, 2, 1}, {2, 0, 3}, {1, 3, 0}});
+    ariel::Graph g2;
+    g2.loadGraph({{0, 1, 0}, {0, 0, 1}, {1, 0, 0}});
+
+    // A symmetric graph squared is symmetric, and the answer is known without a scan
+    ariel::Graph square = g1 * g1;
+    CHECK_FALSE(square.getIsDirected());
+    CHECK(square.printGraph() == "[0, 3, 6]\n[3, 0, 2]\n[6, 2, 0]");
+    CHECK((g2 * g2).getIsDirected());
+    ariel::Graph empty = g2 * 0;
+    CHECK_FALSE((g2 * empty).getIsDirected());
+
+    // Sparse results collect their statistics while they are written
+    ariel::Graph s1;
+    s1.loadGraph({{1, 4, 0}, {0, 0, -6}, {5, 0, 0}}, ariel::Graph::Storage::Sparse);
+    s1 /= 5;
+    CHECK(s1.getNumEdges() == 2);
+    CHECK_FALSE(s1.hasSelfLoops());
+    CHECK(s1.getMinWeight() == -1);
+    ariel::Graph s2 = 12 / s1;
+    CHECK(s2.getMinWeight() == -12);
+    ariel::Graph s3;
+    s3.loadGraph({{2, 0, 0}, {0, 0, 1}, {0, 0, 0}}, ariel::Graph::Storage::Sparse);
+    ariel::Graph s4 = s3 + s1;
+    CHECK(s4.hasSelfLoops());
+    CHECK(s4.getNumEdges() == 2);
+    CHECK(s4.getMaxWeight() == 2);
+}
+
+TEST_CASE("Test operators on expiring graphs")
+{
+    vector<vector<int>> directed = {
+        {0, 1, 0},
+        {0, 0, 2},
+        {3, 0, 0}};
+    vector<vector<int>> other = {
+        {0, 0, 4},
+        {5, 0, 0},
+        {0, 6, 0}};
+    ariel::Graph g1;
+    ariel::Graph g2;
+    g1.loadGraph(directed);
+    g2.loadGraph(other);
+
+    // The result takes over the buffer of the expiring operand
+    const int *cells = g1.row(0).begin();
+    ariel::Graph sum = std::move(g1) + g2;
+    CHECK(sum.row(0).begin() == cells);
+    CHECK(sum.printGraph() == "[0, 1, 4]\n[5, 0, 2]\n[3, 6, 0]");
+
+    cells = sum.row(0).begin();
+    ariel::Graph negated = -(std::move(sum) - g2);
+    CHECK(negated.row(0).begin() == cells);
+    CHECK(negated.printGraph() == "[0, -1, 0]\n[0, 0, -2]\n[-3, 0, 0]");
+
+    // A temporary on the right holds the result of left - right
+    ariel::Graph g3;
+    g3.loadGraph(directed);
+    ariel::Graph difference = g2 - g3 * 2;
+    CHECK(difference.printGraph() == "[0, -2, 4]\n[5, 0, -4]\n[-6, 6, 0]");
+    CHECK(difference.getMinWeight() == -6);
+    CHECK(difference.getIsDirected());
+    ariel::Graph scaled = 3 * (g2 + g3);
+    CHECK(scaled.printGraph() == "[0, 3, 12]\n[15, 0, 6]\n[9, 18, 0]");
+
+    // Post-increment returns the old cells and leaves the shifted ones behind
+    ariel::Graph old = g3++;
+    CHECK(old.printGraph() == "[0, 1, 0]\n[0, 0, 2]\n[3, 0, 0]");
+    CHECK(g3.printGraph() == "[0, 2, 1]\n[1, 0, 3]\n[4, 1, 0]");
+    CHECK(old.getNumEdges() == 3);
+    CHECK(g3.getNumEdges() == 6);
+    ariel::Graph s1;
+    s1.loadGraph(directed, ariel::Graph::Storage::Sparse);
+    ariel::Graph s2 = s1--;
+    CHECK(s2.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(s1.printGraph() == "[0, 0, -1]\n[-1, 0, 1]\n[2, -1, 0]");
+    CHECK(s1.getIsDirected());
+}
+
+TEST_CASE("Test copy-on-write graph storage")
+{
+    vector<vector<int>> directed = {
+        {0, 1, 0},
+        {0, 0, 2},
+        {3, 0, 0}};
+    ariel::Graph g1;
+    g1.loadGraph(directed);
+
+    // A copy shares the cells until one of the graphs is written to
+    ariel::Graph g2 = g1;
+    CHECK(g2.row(0).begin() == g1.row(0).begin());
+    g2 *= 2;
+    CHECK(g2.row(0).begin() != g1.row(0).begin());
+    CHECK(g1.printGraph() == "[0, 1, 0]\n[0, 0, 2]\n[3, 0, 0]");
+    CHECK(g2.printGraph() == "[0, 2, 0]\n[0, 0, 4]\n[6, 0, 0]");
+
+    // Writing to the original leaves an earlier copy untouched
+    ariel::Graph g3 = g1;
+    ++g1;
+    CHECK(g3.printGraph() == "[0, 1, 0]\n[0, 0, 2]\n[3, 0, 0]");
+    CHECK(g1.printGraph() == "[0, 2, 1]\n[1, 0, 3]\n[4, 1, 0]");
+    CHECK(g3.getNumEdges() == 3);
+
+    // Sparse copies share the CSR arrays the same way
+    ariel::Graph s1;
+    s1.loadGraph(directed, ariel::Graph::Storage::Sparse);
+    ariel::Graph s2 = s1;
+    ariel::Graph s3 = s1;
+    s2 *= 0;
+    s3 /= 2;
+    CHECK(s2.getNumEdges() == 0);
+    CHECK(s3.printGraph() == "[0, 0, 0]\n[0, 0, 1]\n[1, 0, 0]");
+    CHECK(s1.printGraph() == "[0, 1, 0]\n[0, 0, 2]\n[3, 0, 0]");
+    CHECK(s1.getNumEdges() == 3);
+    CHECK((-s1).getMinWeight() == -3);
+    CHECK(s1.getMinWeight() == 1);
+}
+
+TEST_CASE("Test graph powers by repeated squaring")
+{
+    vector<vector<int>> cycle = {
+        {0, 1, 0},
+        {0, 0, 2},
+        {3, 0, 0}};
+    ariel::Graph g;
+    g.loadGraph(cycle);
+    ariel::Graph s;
+    s.loadGraph(cycle, ariel::Graph::Storage::Sparse);
+
+    CHECK(g.pow(0).printGraph() == "[1, 0, 0]\n[0, 1, 0]\n[0, 0, 1]");
+    CHECK(g.pow(1) == g);
+    CHECK(g.pow(2).printGraph() == "[0, 0, 2]\n[6, 0, 0]\n[0, 3, 0]");
+    // Closed walks are kept on the diagonal, unlike operator*
+    ariel::Graph cube = g.pow(3);
+    CHECK(cube.printGraph() == "[6, 0, 0]\n[0, 6, 0]\n[0, 0, 6]");
+    CHECK(cube.hasSelfLoops());
+    CHECK(cube.getMaxWeight() == 6);
+    CHECK(s.pow(3).getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(s.pow(3).printGraph() == cube.printGraph());
+    CHECK(s.pow(0).hasSelfLoops());
+
+    // Boolean powers: a walk of exactly k edges
+    CHECK(g.booleanPow(2).printGraph() == "[0, 0, 1]\n[1, 0, 0]\n[0, 1, 0]");
+    CHECK(g.booleanPow(3).printGraph() == "[1, 0, 0]\n[0, 1, 0]\n[0, 0, 1]");
+    CHECK(s.booleanPow(4).printGraph() == "[0, 1, 0]\n[0, 0, 1]\n[1, 0, 0]");
+    CHECK(g.booleanPow(4).getIsDirected());
+
+    // A larger graph against a naive product, with weights small enough not to overflow
+    const size_t n = 40;
+    vector<vector<int>> matrix(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            if (i != j && (i * 7 + j * 3) % 5 == 0)
+            {
+                matrix[i][j] = static_cast<int>((i + j) % 3) - 1;
+            }
+        }
+    }
+    vector<vector<int>> expected = matrix;
+    for (size_t step = 1; step < 5; step++)
+    {
+        vector<vector<int>> next(n, vector<int>(n, 0));
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t k = 0; k < n; k++)
+            {
+                for (size_t j = 0; j < n; j++)
+                {
+                    next[i][j] += expected[i][k] * matrix[k][j];
+                }
+            }
+        }
+        expected = next;
+    }
+    ariel::Graph big;
+    big.loadGraph(matrix);
+    ariel::Graph bigSparse;
+    bigSparse.loadGraph(matrix, ariel::Graph::Storage::Sparse);
+    CHECK(big.pow(5).toMatrix() == expected);
+    CHECK(bigSparse.pow(5).toMatrix() == expected);
+    ariel::Graph pattern = big.booleanPow(5);
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            // A zero sum does not mean there is no walk, so only the converse is checked
+            if (expected[i][j] != 0)
+            {
+                CHECK(pattern.getEdgeWeight(i, j) == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("Test semiring graph multiplication")
+{
+    vector<vector<int>> path = {
+        {0, 4, 0, 9},
+        {0, 0, 2, 0},
+        {0, 0, 0, 1},
+        {0, 0, 0, 0}};
+    ariel::Graph g;
+    g.loadGraph(path);
+
+    // Min-plus: lightest walks of at most k edges
+    ariel::Graph twoHops = g.multiply(g, ariel::Graph::Semiring::MinPlus);
+    CHECK(twoHops.printGraph() == "[0, 4, 6, 9]\n[0, 0, 2, 3]\n[0, 0, 0, 1]\n[0, 0, 0, 0]");
+    ariel::Graph shortest = g.pow(3, ariel::Graph::Semiring::MinPlus);
+    CHECK(shortest.getEdgeWeight(0, 3) == 7);
+    CHECK(g.pow(0, ariel::Graph::Semiring::MinPlus).getNumEdges() == 0);
+    CHECK(g.pow(1, ariel::Graph::Semiring::MinPlus) == g);
+
+    // A negative edge still gives the lightest walk
+    vector<vector<int>> negative = {
+        {0, 5, 2},
+        {0, 0, 0},
+        {0, -4, 0}};
+    ariel::Graph n;
+    n.loadGraph(negative, ariel::Graph::Storage::Sparse);
+    CHECK(n.pow(2, ariel::Graph::Semiring::MinPlus).printGraph() == "[0, -2, 2]\n[0, 0, 0]\n[0, -4, 0]");
+
+    // Boolean: 1 where a walk exists, keeping the storage of sparse operands
+    ariel::Graph reach = g.multiply(g, ariel::Graph::Semiring::Boolean);
+    CHECK(reach.printGraph() == "[0, 0, 1, 0]\n[0, 0, 0, 1]\n[0, 0, 0, 0]\n[0, 0, 0, 0]");
+    CHECK(n.multiply(n, ariel::Graph::Semiring::Boolean).getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(g.pow(2, ariel::Graph::Semiring::Boolean) == g.booleanPow(2));
+    CHECK(g.multiply(g, ariel::Graph::Semiring::Arithmetic) == g * g);
+
+    // All-pairs shortest paths against Floyd-Warshall, large enough to use the thread pool
+    const size_t order = 300;
+    const int none = 1 << 29;
+    vector<vector<int>> matrix(order, vector<int>(order, 0));
+    vector<vector<int>> distance(order, vector<int>(order, none));
+    for (size_t i = 0; i < order; i++)
+    {
+        distance[i][i] = 0;
+        for (size_t j = 0; j < order; j++)
+        {
+            if (i != j && (i * 31 + j * 17) % 23 == 0)
+            {
+                matrix[i][j] = static_cast<int>((i + 2 * j) % 9) + 1;
+                distance[i][j] = matrix[i][j];
+            }
+        }
+    }
+    for (size_t k = 0; k < order; k++)
+    {
+        for (size_t i = 0; i < order; i++)
+        {
+            for (size_t j = 0; j < order; j++)
+            {
+                distance[i][j] = min(distance[i][j], distance[i][k] + distance[k][j]);
+            }
+        }
+    }
+    ariel::Graph big;
+    big.loadGraph(matrix);
+    ariel::Graph::setParallelCutoff(64);
+    ariel::Graph::setThreadCount(4);
+    vector<vector<int>> result = big.pow(order - 1, ariel::Graph::Semiring::MinPlus).toMatrix();
+    ariel::Graph::setThreadCount(0);
+    ariel::Graph::setParallelCutoff(256);
+    bool same = true;
+    for (size_t i = 0; i < order; i++)
+    {
+        for (size_t j = 0; j < order; j++)
+        {
+            same = same && result[i][j] == (distance[i][j] == none ? 0 : distance[i][j]);
+        }
+    }
+    CHECK(same);
+}
+
+TEST_CASE("Test Four Russians boolean product")
+{
+    // Dense enough for the table-driven kernel; 301 vertices leave a partial group at the end
+    const size_t n = 301;
+    vector<vector<int>> matrix(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            if ((i * 13 + j * 7 + i * j) % 3 == 0)
+            {
+                matrix[i][j] = 1;
+            }
+        }
+    }
+    // A sparse graph goes through the row-by-row kernel
+    vector<vector<int>> ring(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        ring[i][(i + 1) % n] = 1;
+        ring[i][(i * 5) % n] = 1;
+    }
+    for (const vector<vector<int>> *operand : {&matrix, &ring})
+    {
+        ariel::BitGraph bits;
+        bits.loadGraph(*operand);
+        ariel::BitGraph square = bits * bits;
+        bool same = true;
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                bool walk = false;
+                for (size_t k = 0; k < n && !walk; k++)
+                {
+                    walk = (*operand)[i][k] != 0 && (*operand)[k][j] != 0;
+                }
+                same = same && square.isAdjacent(i, j) == walk;
+            }
+        }
+        CHECK(same);
+    }
+
+    // Closure-style powers agree with the integer product on which cells are reachable
+    ariel::Graph g;
+    g.loadGraph(matrix);
+    ariel::Graph reach = g.booleanPow(2);
+    ariel::Graph walks = g.pow(2);
+    CHECK(reach.getNumEdges() == walks.getNumEdges());
+    CHECK(!reach.getIsWeighted());
+}
+
+TEST_CASE("Test Strassen graph multiplication")
+{
+    // 150 vertices are padded to whole leaf blocks; 256 split evenly and run in place
+    for (size_t n : {size_t(150), size_t(256)})
+    {
+        vector<vector<int>> matrix(n, vector<int>(n, 0));
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t j = 0; j < n; j++)
+            {
+                if (i != j)
+                {
+                    matrix[i][j] = static_cast<int>((i * 7 + j * 11) % 13) - 6;
+                }
+            }
+        }
+        ariel::Graph g;
+        g.loadGraph(matrix);
+        ariel::Graph::setStrassenCutoff(0);
+        ariel::Graph::setThreadCount(1);
+        ariel::Graph blocked = g * g;
+        ariel::Graph::setStrassenCutoff(100);
+        ariel::Graph strassen = g * g;
+        ariel::Graph::setParallelCutoff(64);
+        ariel::Graph::setThreadCount(4);
+        ariel::Graph parallel = g * g;
+        ariel::Graph::setThreadCount(0);
+        ariel::Graph::setParallelCutoff(256);
+        ariel::Graph::setStrassenCutoff(4096);
+        CHECK(strassen.toMatrix() == blocked.toMatrix());
+        CHECK(parallel.toMatrix() == blocked.toMatrix());
+        CHECK(strassen.getNumEdges() == blocked.getNumEdges());
+        CHECK(strassen.getMinWeight() == blocked.getMinWeight());
+    }
+    CHECK(ariel::Graph::getStrassenCutoff() == 4096);
+}
+
+TEST_CASE("Test overflow-aware graph kernels")
+{
+    const int top = 2147483647;
+    const int bottom = -top - 1;
+    ariel::Graph big;
+    big.loadGraph({{0, top, 0}, {0, 0, 2}, {0, 0, 0}});
+    ariel::Graph ones;
+    ones.loadGraph({{0, 1, 0}, {0, 0, 1}, {0, 0, 0}});
+    ariel::Graph low;
+    low.loadGraph({{0, bottom, 0}, {0, 0, -1}, {0, 0, 0}});
+    ariel::Graph sparse;
+    sparse.loadGraph(big.toMatrix(), ariel::Graph::Storage::Sparse);
+    CHECK(ariel::Graph::getOverflowMode() == ariel::Graph::Overflow::Wrap);
+
+    // The default keeps plain int wrap-around and never flags
+    ariel::Graph wrapped = big + ones;
+    CHECK(wrapped.getEdgeWeight(0, 1) == bottom);
+    CHECK(!wrapped.hasOverflowed());
+    CHECK((bottom / low).getEdgeWeight(0, 1) == 1);
+
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Saturate);
+    ariel::Graph sum = big + ones;
+    CHECK(sum.getEdgeWeight(0, 1) == top);
+    CHECK(sum.getMaxWeight() == top);
+    CHECK(sum.hasOverflowed());
+    CHECK((big * 2).getEdgeWeight(0, 1) == top);
+    CHECK((low - ones).getEdgeWeight(0, 1) == bottom);
+    CHECK((-low).getEdgeWeight(0, 1) == top);
+    CHECK((bottom / low).getEdgeWeight(1, 2) == top);
+    ariel::Graph product = big * big;
+    CHECK(product.getEdgeWeight(0, 2) == top);
+    CHECK(product.hasOverflowed());
+    ariel::Graph sparseProduct = sparse * sparse;
+    CHECK(sparseProduct.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(sparseProduct.toMatrix() == product.toMatrix());
+    CHECK((sparse + ones).getEdgeWeight(0, 1) == top);
+    // Results that fit are exact and unflagged
+    ariel::Graph fits = ones + ones;
+    CHECK(fits.getEdgeWeight(0, 1) == 2);
+    CHECK(!fits.hasOverflowed());
+
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Check);
+    ariel::Graph checked = big + ones;
+    CHECK(checked.getEdgeWeight(0, 1) == bottom);
+    CHECK(checked.hasOverflowed());
+    CHECK((sparse * sparse).hasOverflowed());
+    CHECK(!(ones * ones).hasOverflowed());
+    // The flag follows a graph into the results computed from it
+    CHECK((checked * 1).hasOverflowed());
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Wrap);
+}
+
+TEST_CASE("Test division by a precomputed reciprocal")
+{
+    const int top = 2147483647;
+    const int bottom = -top - 1;
+    // Edge values of the dividend plus a spread of ordinary ones, more than two 16-cell blocks
+    vector<int> cells = {0, 1, -1, 2, -2, 3, -3, 7, -7, 100, -100, top, bottom, top - 1, bottom + 1, 65536, -65536};
+    unsigned int state = 12345;
+    while (cells.size() < 53)
+    {
+        state = state * 1103515245u + 12345u;
+        cells.push_back(static_cast<int>(state));
+    }
+    vector<int> divisors = {2, -2, 3, -3, 5, 7, -7, 10, 16, -16, 641, 1000000007, -1000000007, 1 << 30, top, bottom, bottom + 1};
+    for (int d : divisors)
+    {
+        const ariel::MatrixKernels::Reciprocal divisor(d);
+        vector<int> out(cells.size());
+        ariel::MatrixKernels::divideScalar(cells.data(), out.data(), cells.size(), divisor);
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            CHECK(out[i] == cells[i] / d);
+        }
+    }
+    vector<int> same(cells.size());
+    ariel::MatrixKernels::divideScalar(cells.data(), same.data(), cells.size(), 1);
+    CHECK(same == cells);
+    CHECK_THROWS(ariel::MatrixKernels::Reciprocal(0));
+
+    // Dense and sparse graphs divide the same way
+    ariel::Graph g;
+    g.loadGraph({{0, 9, -10}, {bottom, 0, 7}, {top, -1, 0}});
+    ariel::Graph sparse;
+    sparse.loadGraph(g.toMatrix(), ariel::Graph::Storage::Sparse);
+    g /= -3;
+    sparse /= -3;
+    CHECK(g.toMatrix() == vector<vector<int>>({{0, -3, 3}, {bottom / -3, 0, -2}, {top / -3, 0, 0}}));
+    CHECK(sparse.toMatrix() == g.toMatrix());
+    CHECK(sparse.getNumEdges() == g.getNumEdges());
+}
+
+TEST_CASE("Test subgraph search on large graphs")
+{
+    // A cycle, the same cycle with its vertices relabeled, and the relabeled cycle plus one chord
+    const size_t n = 200;
+    vector<size_t> label(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        label[i] = (i * 37 + 11) % n;
+    }
+    vector<vector<int>> cycle(n, vector<int>(n, 0));
+    vector<vector<int>> shuffled(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        const size_t j = (i + 1) % n;
+        cycle[i][j] = cycle[j][i] = 1;
+        shuffled[label[i]][label[j]] = shuffled[label[j]][label[i]] = 5;
+    }
+    vector<vector<int>> chord = shuffled;
+    chord[label[0]][label[n / 2]] = chord[label[n / 2]][label[0]] = 1;
+    ariel::Graph g1, g2, g3;
+    g1.loadGraph(cycle);
+    g2.loadGraph(shuffled);
+    g3.loadGraph(chord);
+    // Relabeling does not change the order; weights are ignored
+    CHECK(g1 == g2);
+    CHECK_FALSE(g1 < g2);
+    CHECK(g1 < g3);
+    CHECK(g3 > g2);
+    CHECK(g1 <= g3);
+    CHECK(g3 != g1);
+
+    // A directed path is in a directed cycle but not in the reversed cycle with a self loop removed
+    vector<vector<int>> path(13, vector<int>(13, 0));
+    vector<vector<int>> ring(13, vector<int>(13, 0));
+    for (size_t i = 0; i < 13; i++)
+    {
+        ring[i][(i + 1) % 13] = 1;
+        if (i + 1 < 13)
+        {
+            path[i][i + 1] = 1;
+        }
+    }
+    path[4][4] = 1;
+    ariel::Graph p, r;
+    p.loadGraph(path);
+    r.loadGraph(ring);
+    CHECK_FALSE(p < r);
+    ring[9][9] = 1;
+    r.loadGraph(ring);
+    CHECK(p < r);
+    CHECK(r >= p);
+}
+
+TEST_CASE("Test cached graph fingerprints in comparisons")
+{
+    // Two paths with one extra leaf at different places: same degrees, not isomorphic
+    const size_t n = 300;
+    vector<vector<int>> first(n, vector<int>(n, 0));
+    for (size_t i = 0; i + 2 < n; i++)
+    {
+        first[i][i + 1] = first[i + 1][i] = 1;
+    }
+    vector<vector<int>> second = first;
+    first[n - 1][50] = first[50][n - 1] = 1;
+    second[n - 1][120] = second[120][n - 1] = 1;
+    ariel::Graph g1, g2;
+    g1.loadGraph(first);
+    g2.loadGraph(second);
+    // Neither is a subgraph of the other, so they only differ by edge and vertex counts, which are equal
+    CHECK(g1 == g2);
+    CHECK_FALSE(g1 < g2);
+    CHECK_FALSE(g2 < g1);
+
+    // A copy shares the fingerprint until it is written to
+    ariel::Graph g3 = g1;
+    CHECK(g3 == g1);
+    vector<vector<int>> extra(n, vector<int>(n, 0));
+    extra[0][n - 2] = extra[n - 2][0] = 1;
+    ariel::Graph cycle;
+    cycle.loadGraph(extra);
+    g3 += cycle;
+    CHECK(g1 < g3);
+    CHECK(g3 > g2);
+    CHECK(g3 != g1);
+    g3 -= cycle;
+    CHECK(g3 == g1);
+    CHECK(g3 <= g1);
+    CHECK(g3 >= g1);
+
+    // A relabeled copy passes the fingerprint and is found by the search
+    vector<vector<int>> relabeled(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            relabeled[(i * 7 + 3) % n][(j * 7 + 3) % n] = first[i][j];
+        }
+    }
+    ariel::Graph g4;
+    g4.loadGraph(relabeled);
+    CHECK(g4 == g1);
+    CHECK_FALSE(g4 < g3);
+    CHECK(g4 <= g1);
+}
+
+TEST_CASE("Test parallel subgraph search")
+{
+    // Random graphs of several densities; the parallel and serial searches must agree
+    unsigned int state = 2024;
+    for (size_t round = 0; round < 40; round++)
+    {
+        const size_t small = 4 + round % 5;
+        const size_t large = small + round % 4;
+        vector<vector<int>> a(small, vector<int>(small, 0));
+        vector<vector<int>> b(large, vector<int>(large, 0));
+        for (size_t i = 0; i < large; i++)
+        {
+            for (size_t j = 0; j < large; j++)
+            {
+                state = state * 1103515245u + 12345u;
+                if (i != j && (state >> 16) % 10 < 3 + round % 5)
+                {
+                    b[i][j] = 1;
+                }
+                if (i < small && j < small && i != j && (state >> 8) % 10 < 3)
+                {
+                    a[i][j] = 1;
+                }
+            }
+        }
+        ariel::Graph g1, g2;
+        g1.loadGraph(a);
+        g2.loadGraph(b);
+        ariel::Graph::setThreadCount(1);
+        const bool less = g1 < g2;
+        const bool greater = g1 > g2;
+        const bool equal = g1 == g2;
+        ariel::Graph::setThreadCount(4);
+        ariel::Graph::setParallelCutoff(1);
+        // Copies start without cached fingerprints
+        ariel::Graph h1 = g1 * 1;
+        ariel::Graph h2 = g2 * 1;
+        CHECK((h1 < h2) == less);
+        CHECK((h1 > h2) == greater);
+        CHECK((h1 == h2) == equal);
+        CHECK((h1 <= h2) == (less || equal));
+        CHECK((h1 >= h2) == (greater || equal));
+        ariel::Graph::setParallelCutoff(256);
+        ariel::Graph::setThreadCount(0);
+    }
+
+    // A long cycle inside the same cycle plus a chord, found by whichever thread gets there first
+    const size_t n = 300;
+    vector<vector<int>> cycle(n, vector<int>(n, 0));
+    for (size_t i = 0; i < n; i++)
+    {
+        cycle[i][(i + 1) % n] = cycle[(i + 1) % n][i] = 1;
+    }
+    vector<vector<int>> chord = cycle;
+    chord[0][n / 3] = chord[n / 3][0] = 1;
+    ariel::Graph ring, ringWithChord;
+    ring.loadGraph(cycle);
+    ringWithChord.loadGraph(chord);
+    ariel::Graph::setThreadCount(4);
+    CHECK(ring < ringWithChord);
+    CHECK(ringWithChord >= ring);
+    ariel::Graph::setThreadCount(0);
+}
+
+TEST_CASE("Test sorting a collection of graphs")
+{
+    // Random small graphs, with every fourth one a relabeled copy of the one before
+    unsigned int state = 77;
+    vector<ariel::Graph> graphs;
+    for (size_t k = 0; k < 60; k++)
+    {
+        const size_t n = 3 + k % 4;
+        vector<vector<int>> matrix(n, vector<int>(n, 0));
+        if (k % 4 == 3)
+        {
+            const vector<vector<int>> previous = graphs.back().toMatrix();
+            const size_t m = previous.size();
+            matrix.assign(m, vector<int>(m, 0));
+            for (size_t i = 0; i < m; i++)
+            {
+                for (size_t j = 0; j < m; j++)
+                {
+                    matrix[(i + 1) % m][(j + 1) % m] = previous[i][j];
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                for (size_t j = 0; j < n; j++)
+                {
+                    state = state * 1103515245u + 12345u;
+                    if (i != j && (state >> 16) % 3 == 0)
+                    {
+                        matrix[i][j] = 1 + static_cast<int>((state >> 20) % 4);
+                    }
+                }
+            }
+        }
+        ariel::Graph g;
+        g.loadGraph(matrix);
+        graphs.push_back(g);
+    }
+
+    // Every pair is ordered exactly like the operators order it
+    ariel::GraphSorter sorter(graphs);
+    for (size_t i = 0; i < graphs.size(); i++)
+    {
+        for (size_t j = 0; j < graphs.size(); j++)
+        {
+            const int order = sorter.compare(i, j);
+            CHECK((order < 0) == (graphs[i] < graphs[j]));
+            CHECK((order > 0) == (graphs[i] > graphs[j]));
+            CHECK((order == 0) == (graphs[i] == graphs[j]));
+        }
+    }
+    // Searches are only run for pairs the counts cannot order, and never twice
+    const size_t tests = sorter.getSubgraphTests();
+    CHECK(tests < graphs.size() * graphs.size() / 4);
+    sorter.order();
+    CHECK(sorter.getSubgraphTests() == tests);
+
+    vector<ariel::Graph> sorted = graphs;
+    ariel::GraphSorter::sort(sorted);
+    CHECK(sorted.size() == graphs.size());
+    for (size_t i = 0; i + 1 < sorted.size(); i++)
+    {
+        CHECK_FALSE(sorted[i + 1] < sorted[i]);
+    }
+    vector<ariel::Graph> unique = graphs;
+    ariel::GraphSorter::sortUnique(unique);
+    CHECK(unique.size() < graphs.size());
+    for (size_t i = 0; i + 1 < unique.size(); i++)
+    {
+        CHECK(unique[i] != unique[i + 1]);
+    }
+}
+
+TEST_CASE("Test subgraph search with bitset domains")
+{
+    // A random 40-vertex pattern planted in a random 300-vertex graph under a relabeling
+    unsigned int state = 99;
+    const size_t small = 40;
+    const size_t large = 300;
+    vector<vector<int>> pattern(small, vector<int>(small, 0));
+    vector<vector<int>> target(large, vector<int>(large, 0));
+    for (size_t i = 0; i < large; i++)
+    {
+        for (size_t j = i + 1; j < large; j++)
+        {
+            state = state * 1103515245u + 12345u;
+            if ((state >> 16) % 100 < 4)
+            {
+                target[i][j] = target[j][i] = 1;
+            }
+            if (j < small && (state >> 8) % 100 < 12)
+            {
+                pattern[i][j] = pattern[j][i] = 3;
+            }
+        }
+    }
+    for (size_t i = 0; i < small; i++)
+    {
+        for (size_t j = 0; j < small; j++)
+        {
+            if (pattern[i][j] != 0)
+            {
+                target[(i * 7 + 5) % large][(j * 7 + 5) % large] = 1;
+            }
+        }
+    }
+    ariel::Graph g1, g2;
+    g1.loadGraph(pattern);
+    g2.loadGraph(target);
+    CHECK(g1 < g2);
+    CHECK(g2 > g1);
+
+    // A triangle never fits in a bipartite graph, however dense
+    vector<vector<int>> bipartite(large, vector<int>(large, 0));
+    for (size_t i = 0; i < large; i += 2)
+    {
+        for (size_t j = 1; j < large; j += 2)
+        {
+            bipartite[i][j] = bipartite[j][i] = 1;
+        }
+    }
+    // A triangle with a pendant edge, and a 4-cycle that does fit
+    ariel::Graph triangle, complete;
+    triangle.loadGraph({{0, 1, 1, 0}, {1, 0, 1, 0}, {1, 1, 0, 1}, {0, 0, 1, 0}});
+    complete.loadGraph(bipartite);
+    CHECK(triangle < complete);
+    ariel::Graph square;
+    square.loadGraph({{0, 1, 0, 1}, {1, 0, 1, 0}, {0, 1, 0, 1}, {1, 0, 1, 0}});
+    CHECK(square < complete);
+    // Neither fits in the other, so only the equal edge and vertex counts decide
+    CHECK(triangle == square);
+}
+
+TEST_CASE("Test scalar products that wrap keep exact statistics")
+{
+    // 65536 * 65536 wraps to 0 and 2^30 * 2 wraps to INT_MIN in the default Wrap mode
+    const vector<vector<int>> matrix = {{0, 65536, 0}, {0, 0, 1}, {0, 0, 0}};
+    ariel::Graph dense;
+    dense.loadGraph(matrix);
+    ariel::Graph sparse;
+    sparse.loadGraph(matrix, ariel::Graph::Storage::Sparse);
+    ariel::Graph product = dense * 65536;
+    CHECK(product.getNumEdges() == 1);
+    CHECK(product.getMaxWeight() == 65536);
+    dense *= 65536;
+    CHECK(dense.getNumEdges() == 1);
+    sparse *= 65536;
+    CHECK(sparse.getNumEdges() == 1);
+    CHECK(sparse.toMatrix() == dense.toMatrix());
+
+    ariel::Graph large;
+    large.loadGraph({{0, 1 << 30, 0}, {0, 0, 3}, {0, 0, 0}});
+    ariel::Graph doubled = large * 2;
+    CHECK(doubled.hasNegativeWeights());
+    CHECK(doubled.getMinWeight() == -2147483647 - 1);
+    CHECK(doubled.getMaxWeight() == 6);
+    large *= 2;
+    CHECK(large.hasNegativeWeights());
+    CHECK(large.getMinWeight() == doubled.getMinWeight());
+
+    // Negating INT_MIN wraps back to INT_MIN
+    ariel::Graph negated = -doubled;
+    CHECK(negated.getMinWeight() == doubled.getMinWeight());
+    CHECK(negated.getMaxWeight() == -6);
+    CHECK(negated.hasNegativeWeights());
+}
+
+TEST_CASE("Test dense storage keeps undirected rows addressable")
+{
+    vector<vector<int>> graph = {
+        {0, 2, 0},
+        {2, 0, 5},
+        {0, 5, 0}};
+    ariel::Graph packed;
+    packed.loadGraph(graph, ariel::Graph::Storage::Auto);
+    CHECK(packed.getStorage() == ariel::Graph::Storage::Symmetric);
+    CHECK_THROWS(packed.row(1));
+
+    // The default is dense: the symmetric matrix is kept in full rows
+    ariel::Graph dense;
+    dense.loadGraph(graph);
+    CHECK(dense.getStorage() == ariel::Graph::Storage::Dense);
+    CHECK_FALSE(dense.getIsDirected());
+    CHECK(dense.getNumEdges() == 2);
+    ariel::Graph::RowView row = dense.row(1);
+    CHECK(vector<int>(row.begin(), row.end()) == vector<int>{2, 0, 5});
+    CHECK(dense == packed);
+
+    // Auto only packs symmetric matrices
+    ariel::Graph directed;
+    directed.loadGraph({{0, 1}, {0, 0}}, ariel::Graph::Storage::Auto);
+    CHECK(directed.getStorage() == ariel::Graph::Storage::Dense);
+    CHECK(directed.row(0)[1] == 1);
+}
+
+TEST_CASE("Test min-plus walks clamp instead of wrapping")
+{
+    ariel::Graph heavy;
+    heavy.loadGraph({{0, INT_MAX - 10, 0}, {0, 0, 100}, {0, 0, 0}});
+    ariel::Graph light;
+    light.loadGraph({{0, INT_MIN + 10, 0}, {0, 0, -100}, {0, 0, 0}});
+
+    // The walk 0 -> 1 -> 2 stays reachable with the largest finite weight
+    ariel::Graph far = heavy.pow(2, ariel::Graph::Semiring::MinPlus);
+    CHECK(far.getEdgeWeight(0, 2) == INT_MAX - 1);
+    CHECK(far.getEdgeWeight(0, 1) == INT_MAX - 10);
+    CHECK_FALSE(far.hasOverflowed());
+    ariel::Graph near = light.multiply(light, ariel::Graph::Semiring::MinPlus);
+    CHECK(near.getEdgeWeight(0, 2) == INT_MIN);
+
+    // A wide row goes through the vectorized blocks as well as the scalar tail
+    vector<vector<int>> matrix(40, vector<int>(40, 0));
+    for (size_t j = 1; j < 40; j++)
+    {
+        matrix[0][j] = INT_MAX - 5;
+        matrix[j][0] = 7;
+    }
+    ariel::Graph wide;
+    wide.loadGraph(matrix);
+    ariel::Graph walks = wide.multiply(wide, ariel::Graph::Semiring::MinPlus);
+    for (size_t j = 1; j < 40; j++)
+    {
+        CHECK(walks.getEdgeWeight(j, j) == 0);
+        CHECK(walks.getEdgeWeight(j, 1) == (j == 1 ? 0 : INT_MAX - 1));
+    }
+
+    // The checking modes report the clamp
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Check);
+    CHECK(heavy.pow(2, ariel::Graph::Semiring::MinPlus).hasOverflowed());
+    CHECK(light.multiply(light, ariel::Graph::Semiring::MinPlus).hasOverflowed());
+    CHECK_FALSE(heavy.multiply(light, ariel::Graph::Semiring::MinPlus).hasOverflowed());
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Wrap);
+}
+
+TEST_CASE("Test sparse lazy expressions merge the rows of their graphs")
+{
+    // A ring with a few chords on a graph far too large to expand row by row
+    const size_t order = 200000;
+    ariel::GraphBuilder ring(order);
+    ariel::GraphBuilder chords(order);
+    for (size_t v = 0; v < order; v++)
+    {
+        ring.addEdge(v, (v + 1) % order, 2);
+        if (v % 1000 == 0)
+        {
+            chords.addEdge(v, (v + 1) % order, 1);
+            chords.addEdge(v, (v + 500) % order, 3);
+            chords.addEdge(v, v, 4);
+        }
+    }
+    ariel::Graph g1 = ring.build();
+    ariel::Graph g2 = chords.build();
+
+    // 2 * ring - 4 * chords cancels the chord edges that lie on the ring
+    ariel::Graph merged = ariel::lazy(g1) + g1 - 2 * ariel::lazy(g2) - ariel::lazy(g2) * 2;
+    CHECK(merged.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(merged.getNumEdges() == order - order / 1000 + 2 * (order / 1000));
+    CHECK(merged.getEdgeWeight(0, 1) == 0);
+    CHECK(merged.getEdgeWeight(1, 2) == 4);
+    CHECK(merged.getEdgeWeight(0, 500) == -12);
+    CHECK(merged.getEdgeWeight(1000, 1000) == -16);
+    CHECK(merged.hasSelfLoops());
+    CHECK(merged.getMinWeight() == -16);
+    CHECK(merged.getMaxWeight() == 4);
+    CHECK(merged == g1 + g1 - 2 * g2 - g2 * 2);
+
+    // The neighbours of every row come out in increasing column order
+    vector<size_t> targets;
+    for (const ariel::Graph::Edge &edge : merged.neighbors(199000))
+    {
+        targets.push_back(edge.vertex);
+    }
+    CHECK(targets == vector<size_t>{199000, 199500});
+}
+
+TEST_CASE("Test boolean products derive their symmetry")
+{
+    ariel::BitGraph path;
+    path.loadGraph({{0, 1, 0, 0}, {1, 0, 1, 0}, {0, 1, 0, 1}, {0, 0, 1, 0}});
+    CHECK(path.isKnownSymmetric());
+    CHECK((path * path).isKnownSymmetric());
+    CHECK(path.pow(5).isKnownSymmetric());
+    CHECK_FALSE(path.pow(5).getIsDirected());
+
+    // Other products find their symmetry on the first query
+    ariel::BitGraph chain;
+    chain.loadGraph({{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {0, 0, 0, 0}});
+    ariel::BitGraph mixed = path * chain;
+    CHECK_FALSE(mixed.isKnownSymmetric());
+    CHECK(mixed.getIsDirected());
+    ariel::BitGraph back = chain.transposed() * chain;
+    CHECK_FALSE(back.isKnownSymmetric());
+    CHECK_FALSE(back.getIsDirected());
+    CHECK(back.isKnownSymmetric());
+
+    ariel::Graph g;
+    g.loadGraph({{0, 1, 0, 0}, {1, 0, 1, 0}, {0, 1, 0, 1}, {0, 0, 1, 0}});
+    CHECK_FALSE(g.multiply(g, ariel::Graph::Semiring::Boolean).getIsDirected());
+    CHECK_FALSE(g.booleanPow(3).getIsDirected());
+    ariel::Graph d;
+    d.loadGraph({{0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}, {0, 0, 0, 0}});
+    CHECK(g.multiply(d, ariel::Graph::Semiring::Boolean).getIsDirected());
+}
+
+TEST_CASE("Test sorting graphs that operator< does not order transitively")
+{
+    // An undirected triangle counts 3 edges, yet it contains the directed graph with 5 of its 6 arcs
+    ariel::Graph triangle;
+    triangle.loadGraph({{0, 1, 1}, {1, 0, 1}, {1, 1, 0}});
+    ariel::Graph arcs;
+    arcs.loadGraph({{0, 1, 1}, {1, 0, 1}, {1, 0, 0}});
+    ariel::Graph square;
+    square.loadGraph({{0, 1, 0, 1}, {1, 0, 1, 0}, {0, 1, 0, 1}, {1, 0, 1, 0}});
+    CHECK(triangle < square);
+    CHECK(square < arcs);
+    CHECK(arcs < triangle);
+
+    // No order is ascending here, but every graph is kept exactly once
+    for (size_t start = 0; start < 3; start++)
+    {
+        vector<ariel::Graph> graphs = {triangle, square, arcs};
+        std::rotate(graphs.begin(), graphs.begin() + static_cast<std::ptrdiff_t>(start), graphs.end());
+        ariel::GraphSorter sorter(graphs);
+        vector<size_t> positions = sorter.order();
+        std::sort(positions.begin(), positions.end());
+        CHECK(positions == vector<size_t>{0, 1, 2});
+        CHECK(sorter.uniqueOrder().size() == 3);
+    }
+}
+
+TEST_CASE("Test Strassen products near the int limit under checked overflow")
+{
+    // 4095^2 * 128 fits in an int, so the checked product stays on the int kernels, but the
+    // quadrant sums of Strassen's recursion reach up to four times that
+    const size_t order = 128;
+    vector<vector<int>> left(order, vector<int>(order));
+    vector<vector<int>> right(order, vector<int>(order));
+    for (size_t i = 0; i < order; i++)
+    {
+        for (size_t j = 0; j < order; j++)
+        {
+            left[i][j] = ((i + j) % 3 == 0) ? -4095 : 4095;
+            right[i][j] = ((i * j) % 5 == 1) ? -4095 : 4095;
+        }
+    }
+    ariel::Graph g1;
+    ariel::Graph g2;
+    g1.loadGraph(left);
+    g2.loadGraph(right);
+
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Check);
+    const size_t cutoff = ariel::Graph::getStrassenCutoff();
+    ariel::Graph::setStrassenCutoff(0);
+    ariel::Graph tiled = g1 * g2;
+    ariel::Graph::setStrassenCutoff(order);
+    ariel::Graph strassen = g1 * g2;
+    ariel::Graph::setStrassenCutoff(cutoff);
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Wrap);
+
+    CHECK_FALSE(tiled.hasOverflowed());
+    CHECK_FALSE(strassen.hasOverflowed());
+    CHECK(strassen.toMatrix() == tiled.toMatrix());
+    long long expected = 0;
+    for (size_t k = 0; k < order; k++)
+    {
+        expected += static_cast<long long>(left[0][k]) * right[k][1];
+    }
+    CHECK(strassen.getEdgeWeight(0, 1) == expected);
+}
+
+TEST_CASE("Test lazy expressions follow the overflow mode")
+{
+    ariel::Graph big;
+    big.loadGraph({{0, INT_MAX, 0}, {0, 0, INT_MIN}, {5, 0, 0}});
+    ariel::Graph one;
+    one.loadGraph({{0, 1, 0}, {0, 0, 1}, {1, 0, 0}});
+
+    // Wrap keeps the eager result and no flag
+    ariel::Graph wrapped = ariel::lazy(big) + one - 2 * ariel::lazy(one);
+    CHECK(wrapped.printGraph() == (big + one - 2 * one).printGraph());
+    CHECK_FALSE(wrapped.hasOverflowed());
+
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Saturate);
+    ariel::Graph saturated = ariel::lazy(big) + one;
+    CHECK(saturated.getEdgeWeight(0, 1) == INT_MAX);
+    CHECK(saturated.getEdgeWeight(1, 2) == INT_MIN + 1);
+    CHECK(saturated.hasOverflowed());
+    ariel::Graph scaled = 3 * ariel::lazy(big) - one;
+    CHECK(scaled.getEdgeWeight(0, 1) == INT_MAX - 1);
+    CHECK(scaled.getEdgeWeight(1, 2) == INT_MIN);
+    CHECK(scaled.getEdgeWeight(2, 0) == 14);
+
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Check);
+    ariel::Graph checked = ariel::lazy(big) - one;
+    CHECK(checked.getEdgeWeight(1, 2) == INT_MAX);
+    CHECK(checked.hasOverflowed());
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Wrap);
+
+    // A result computed from an overflowed graph keeps the flag, in sparse form as well
+    ariel::Graph later = ariel::lazy(checked) + one;
+    CHECK(later.hasOverflowed());
+    ariel::Graph s1;
+    s1.loadGraph({{0, INT_MAX}, {0, 0}}, ariel::Graph::Storage::Sparse);
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Check);
+    ariel::Graph sparseSum = ariel::lazy(s1) + s1;
+    ariel::Graph::setOverflowMode(ariel::Graph::Overflow::Wrap);
+    CHECK(sparseSum.getStorage() == ariel::Graph::Storage::Sparse);
+    CHECK(sparseSum.getEdgeWeight(0, 1) == -2);
+    CHECK(sparseSum.hasOverflowed());
+    ariel::Graph fromSparse = ariel::lazy(sparseSum) - s1;
+    CHECK(fromSparse.hasOverflowed());
+}
+
+TEST_CASE("Test traversals of long sparse paths")
+{
+    // A path of a million vertices is far deeper than the call stack allows for a recursive DFS
+    const size_t n = 1000000;
+    ariel::GraphBuilder builder(n);
+    builder.reserve(2 * n);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        builder.addUndirectedEdge(i, i + 1);
+    }
+    ariel::Graph path = builder.build();
+    CHECK(ariel::Algorithms::isConnected(path) == true);
+    CHECK(ariel::Algorithms::isContainsCycle(path) == false);
+
+    // Directed: a one-way path only reaches forward, closing it into a ring connects it
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        builder.addEdge(i, i + 1);
+    }
+    ariel::Graph oneWay = builder.build();
+    CHECK(ariel::Algorithms::isConnected(oneWay) == false);
+    builder.addEdge(n - 1, 0);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        builder.addEdge(i, i + 1);
+    }
+    ariel::Graph ring = builder.build();
+    CHECK(ariel::Algorithms::isConnected(ring) == true);
+}
+
+TEST_CASE("Test const queries from several threads")
+{
+    // Nothing below is cached yet, so every thread races to fill the same symmetry and fingerprint caches
+    const size_t n = 2000;
+    ariel::GraphBuilder builder(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        builder.addUndirectedEdge(i, (i + 1) % n, 2);
+    }
+    const ariel::Graph ring = builder.build();
+    builder.addEdge(5, 5);
+    const ariel::Graph loop = builder.build();
+
+    vector<int> answers(4, 0);
+    vector<std::thread> threads;
+    for (size_t t = 0; t < answers.size(); t++)
+    {
+        threads.push_back(std::thread([&ring, &loop, &answers, t]()
+                                      { answers[t] = (!ring.getIsDirected() ? 1 : 0) + (loop < ring ? 2 : 0) + (ring.getMaxWeight() == 2 ? 4 : 0); }));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (int answer : answers)
+    {
+        CHECK(answer == 7);
+    }
+}
+
+TEST_CASE("Test bit graph symmetry from several threads")
+{
+    // A product leaves the symmetry unknown until the first query scans the bits
+    ariel::Graph g;
+    g.loadGraph({{0, 1, 0}, {0, 0, 1}, {1, 0, 0}}, ariel::Graph::Storage::Dense);
+    const ariel::BitGraph bits(g);
+    const ariel::BitGraph square = bits * bits.transposed();
+
+    vector<int> answers(4, 0);
+    vector<std::thread> threads;
+    for (size_t t = 0; t < answers.size(); t++)
+    {
+        threads.push_back(std::thread([&square, &answers, t]()
+                                      { answers[t] = square.getIsDirected() ? 1 : 2; }));
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    for (int answer : answers)
+    {
+        CHECK(answer == 2);
+    }
+}
+
+TEST_CASE("Test nested parallel loops run inline")
+{
+    // Every thread of the pool is busy with the outer loop, so the inner loops run on their own thread
+    ariel::ThreadPool pool(4);
+    vector<int> cells(64 * 64, 0);
+    pool.parallelFor(64, 1, [&pool, &cells](size_t begin, size_t end)
+                     {
+                         for (size_t i = begin; i < end; i++)
+                         {
+                             pool.parallelFor(64, 8, [&cells, i](size_t first, size_t last)
+                                              {
+                                                  for (size_t j = first; j < last; j++)
+                                                  {
+                                                      cells[i * 64 + j] = static_cast<int>(i + j);
+                                                  }
+                                              });
+                         }
+                     });
+    CHECK(cells[0] == 0);
+    CHECK(cells[63 * 64 + 63] == 126);
+    CHECK(std::count(cells.begin(), cells.end(), 0) == 1);
 }
\ No newline at end of file
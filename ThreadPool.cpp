@@ -0,0 +1,125 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+namespace ariel
+{
+    thread_local const ThreadPool *ThreadPool::running = nullptr;
+
+    ThreadPool::ThreadPool(size_t threads)
+        : task(nullptr), count(0), grain(1), next(0), busy(0), generation(0), stopping(false)
+    {
+        for (size_t i = 1; i < threads; i++)
+        {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            lock_guard<mutex> lock(this->stateMutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::getThreadCount() const
+    {
+        return workers.size() + 1;
+    }
+
+    void ThreadPool::parallelFor(size_t count, size_t grain, const RangeTask &task)
+    {
+        if (grain == 0)
+        {
+            grain = 1;
+        }
+        // A single chunk, a single thread or a nested call: no hand-off needed.
+        // A nested call would otherwise wait on jobMutex, which the outer call holds.
+        if (workers.empty() || count <= grain || running == this)
+        {
+            if (count > 0)
+            {
+                task(0, count);
+            }
+            return;
+        }
+
+        lock_guard<mutex> job(this->jobMutex);
+        {
+            lock_guard<mutex> lock(this->stateMutex);
+            this->task = &task;
+            this->count = count;
+            this->grain = grain;
+            this->next = 0;
+            this->busy = workers.size();
+            ++this->generation;
+        }
+        this->wake.notify_all();
+        runChunks();
+
+        // The task lives on the caller's stack, so wait until every worker has left it
+        unique_lock<mutex> lock(this->stateMutex);
+        this->finished.wait(lock, [this]
+                            { return this->busy == 0; });
+        this->task = nullptr;
+    }
+
+    void ThreadPool::runChunks()
+    {
+        const ThreadPool *outer = running;
+        running = this;
+        for (size_t begin = this->next.fetch_add(this->grain); begin < this->count; begin = this->next.fetch_add(this->grain))
+        {
+            (*this->task)(begin, min(begin + this->grain, this->count));
+        }
+        running = outer;
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        size_t seen = 0;
+        while (true)
+        {
+            {
+                unique_lock<mutex> lock(this->stateMutex);
+                this->wake.wait(lock, [this, seen]
+                                { return this->stopping || this->generation != seen; });
+                if (this->stopping)
+                {
+                    return;
+                }
+                seen = this->generation;
+            }
+            runChunks();
+            {
+                lock_guard<mutex> lock(this->stateMutex);
+                --this->busy;
+            }
+            this->finished.notify_one();
+        }
+    }
+
+    ThreadPool &ThreadPool::shared(size_t threads)
+    {
+        static mutex poolMutex;
+        static unique_ptr<ThreadPool> pool;
+        lock_guard<mutex> lock(poolMutex);
+        if (!pool || pool->getThreadCount() != max<size_t>(threads, 1))
+        {
+            pool.reset();
+            pool.reset(new ThreadPool(threads));
+        }
+        return *pool;
+    }
+}
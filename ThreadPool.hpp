@@ -0,0 +1,91 @@
+// Daniel Tsadik
+// ID: 209307727
+// Mail: tsadik88@gmail.com
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ariel
+{
+    /**
+     * @brief Fixed set of worker threads that split a range of indices between them.
+     *
+     * The calling thread takes part in every parallelFor, so a pool of N threads starts
+     * N - 1 workers. Every thread takes the next chunk from one shared atomic counter, so a
+     * thread that finishes early keeps taking chunks instead of idling. There are no
+     * per-thread queues and no work stealing; with equal-sized chunks the counter is enough.
+     */
+    class ThreadPool
+    {
+    public:
+        typedef std::function<void(size_t, size_t)> RangeTask;
+
+        /**
+         * @brief Starts a pool.
+         *
+         * @param threads The total number of threads, including the caller; 0 is treated as 1.
+         */
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t getThreadCount() const;
+
+        /**
+         * @brief Runs task(begin, end) over [0, count) in chunks of grain indices and waits for all of them.
+         *
+         * Calls from several threads are serialized. A call made from inside a task of the
+         * same pool runs the whole range inline on the calling thread, since every thread of
+         * the pool is already busy with the outer call. The task must not throw.
+         *
+         * @param count The number of indices.
+         * @param grain The number of indices per chunk.
+         * @param task The work for one chunk.
+         */
+        void parallelFor(size_t count, size_t grain, const RangeTask &task);
+
+        /**
+         * @brief Returns the process-wide pool with the given number of threads.
+         *
+         * The pool is recreated when the number changes; this must not happen while another
+         * thread is inside parallelFor on the previous pool.
+         *
+         * @param threads The total number of threads.
+         * @return The shared pool.
+         */
+        static ThreadPool &shared(size_t threads);
+
+    private:
+        void workerLoop();
+        void runChunks();
+
+        // The pool whose chunks the current thread is running, if any
+        static thread_local const ThreadPool *running;
+
+        std::vector<std::thread> workers;
+        std::mutex jobMutex;   // Held for a whole parallelFor
+        std::mutex stateMutex; // Guards the fields below
+        std::condition_variable wake;
+        std::condition_variable finished;
+        const RangeTask *task;
+        size_t count;
+        size_t grain;
+        std::atomic<size_t> next;
+        size_t busy;
+        size_t generation;
+        bool stopping;
+    };
+}
+
+#endif